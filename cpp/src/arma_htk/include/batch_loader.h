@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	batch_loader.h
+//
+// summary:	Declares the BatchLoader_T class, which loads many HTK files or archive entries into one
+// 			contiguous buffer
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "feature_archive.h"
+#include "htk_byte_order.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+template<typename eT> class BatchLoader_T;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The features of several utterances in one contiguous buffer. </summary>
+/// <details>
+/// The frames of all utterances follow each other, one column per frame (features() x frames()),
+/// the frames of utterance i start at column offset(i). As a row-major array this is the
+/// frames() x features() matrix a training framework expects.
+/// </details>
+///
+/// <typeparam name="eT">	Element type, double or float. </typeparam>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+class FeatureBatch_T
+{
+public:
+
+	FeatureBatch_T() : offsets_(1, 0), features_(0) {}
+
+	/// <summary>	Number of utterances. </summary>
+	std::size_t size() const { return offsets_.size() - 1; }
+
+	/// <summary>	Number of features per frame. </summary>
+	arma::uword features() const { return features_; }
+
+	/// <summary>	Number of frames of all utterances. </summary>
+	arma::uword frames() const { return offsets_.back(); }
+
+	/// <summary>	Number of frames of utterance i. </summary>
+	arma::uword frames(std::size_t i) const { return offsets_[i + 1] - offsets_[i]; }
+
+	/// <summary>	The first frame of utterance i. </summary>
+	arma::uword offset(std::size_t i) const { return offsets_[i]; }
+
+	/// <summary>	The features of the first frame. </summary>
+	const eT* memptr() const { return buffer_.data(); }
+
+	eT* memptr() { return buffer_.data(); }
+
+	/// <summary>	All frames, a matrix using the memory of the batch. </summary>
+	arma::Mat<eT> matrix() { return view(0, frames()); }
+
+	/// <summary>	The frames of utterance i, a matrix using the memory of the batch. </summary>
+	arma::Mat<eT> utterance(std::size_t i) { return view(offsets_[i], frames(i)); }
+
+private:
+
+	friend class BatchLoader_T<eT>;
+
+	arma::Mat<eT> view(arma::uword first, arma::uword count)
+	{
+		if (count == 0) {
+			return arma::Mat<eT>(features_, 0);
+		}
+		return arma::Mat<eT>(buffer_.data() + first * features_, features_, count, false, true);
+	}
+
+	/// <summary>	The frames. Only grows, so a recycled batch does not allocate again. </summary>
+	std::vector<eT> buffer_;
+
+	/// <summary>	The first frame of every utterance, followed by the number of frames. </summary>
+	std::vector<arma::uword> offsets_;
+
+	arma::uword features_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Loads minibatches of HTK files or archive entries into pooled buffers. </summary>
+/// <details>
+/// A batch is loaded in two parallel passes on a small pool of I/O threads. The first maps the
+/// files and reads their headers, the second decodes every file straight into its place in the
+/// buffer of the batch. The batches are taken from a pool: hand a batch back with recycle()
+/// when it is no longer used and the next load reuses its buffer without allocating.
+///
+/// load() and recycle() may be called from different threads, e.g. a prefetching thread and
+/// the training loop. Concurrent calls of load() are serialized.
+/// </details>
+///
+/// <typeparam name="eT">	Element type, double or float. </typeparam>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+class BatchLoader_T
+{
+public:
+
+	typedef FeatureBatch_T<eT> Batch;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Constructor. </summary>
+	///
+	/// <param name="threads">	(Optional) number of I/O threads, including the calling thread. </param>
+	/// <param name="order">  	(Optional) the byte order of the HTK files. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	explicit BatchLoader_T(int threads = 4, HTKByteOrder order = HTKByteOrder::big_endian);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Loads HTK files. </summary>
+	/// <details>
+	/// Throws std::runtime_error if a file cannot be read or the files have different numbers of
+	/// features.
+	/// </details>
+	///
+	/// <param name="paths">	The files, utterance i of the batch is paths[i]. </param>
+	///
+	/// <returns>	The batch. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	std::unique_ptr<Batch> load(const std::vector<std::string>& paths);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Loads entries of an archive. </summary>
+	/// <details>
+	/// Throws std::runtime_error if a key is missing or the entries have different numbers of
+	/// features.
+	/// </details>
+	///
+	/// <param name="archive">	The archive. </param>
+	/// <param name="keys">   	The keys, utterance i of the batch is keys[i]. </param>
+	///
+	/// <returns>	The batch. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	std::unique_ptr<Batch> load(const ArchiveReader& archive, const std::vector<std::string>& keys);
+
+	/// <summary>	Returns a batch to the pool. </summary>
+	void recycle(std::unique_ptr<Batch> batch);
+
+	/// <summary>	Number of batches in the pool. </summary>
+	std::size_t pooled() const;
+
+private:
+
+	/// <summary>	A batch from the pool, or a new one. </summary>
+	std::unique_ptr<Batch> acquire();
+
+	/// <summary>	Sets the offsets from the frame counts and sizes the buffer. </summary>
+	static void allocate(Batch& batch, const std::vector<arma::uword>& frames, arma::uword features);
+
+	HTKByteOrder order_;
+
+	/// <summary>	Serializes load(), which uses the members below. </summary>
+	std::mutex load_mutex_;
+	ThreadPool pool_;
+	std::vector<MappedFile> files_;
+	std::vector<arma::uword> frames_;
+	std::vector<int> features_;
+
+	mutable std::mutex pool_mutex_;
+	std::vector<std::unique_ptr<Batch>> free_;
+};
+
+/// <summary>	Double precision batches. </summary>
+typedef BatchLoader_T<double> BatchLoader;
+
+/// <summary>	Single precision batches. </summary>
+typedef BatchLoader_T<float> BatchLoader_F;
@@ -0,0 +1,259 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	feature_archive.h
+//
+// summary:	Declares the ArchiveWriter and ArchiveReader classes for storing many feature matrices
+// 			in a few large shard files with a sorted index
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "feature_layout.h"
+#include "mapped_file.h"
+
+/// <summary>	How the matrices are stored in the shards. </summary>
+enum class ArchiveEncoding : uint16_t
+{
+	/// <summary>	Native-endian floats, one frame after the other. Can be viewed without a copy. </summary>
+	native_float = 0,
+
+	/// <summary>	A complete HTK file, see HTKFile::save. </summary>
+	htk = 1
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Writes an archive of feature matrices. </summary>
+/// <details>
+/// An archive with the prefix p consists of the shards p.00000.shard, p.00001.shard, ... and the
+/// index p.index. The matrices are appended to the current shard, each at a multiple of 64 bytes,
+/// and a new shard is started once the current one holds shard_size bytes. close() writes the
+/// index, which lists the keys in sorted order with their shard, offset, number of frames and
+/// features and parameter kind.
+///
+/// The index and the native_float matrices are written in the byte order of the machine, so an
+/// archive can only be read on a machine with the same byte order.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ArchiveWriter
+{
+public:
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Creates the first shard. Throws std::runtime_error if it cannot be created. </summary>
+	///
+	/// <param name="prefix">	 	The prefix of the files of the archive. </param>
+	/// <param name="encoding">  	(Optional) how the matrices are stored. </param>
+	/// <param name="layout">	 	(Optional) the layout of the matrices passed to add. </param>
+	/// <param name="shard_size">	(Optional) the size at which a new shard is started. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	explicit ArchiveWriter(const std::string& prefix, ArchiveEncoding encoding = ArchiveEncoding::native_float,
+		FeatureLayout layout = FeatureLayout::frame_major, uint64_t shard_size = uint64_t(1) << 30);
+
+	/// <summary>	Destructor. Closes the archive, see close(). Errors are ignored. </summary>
+	~ArchiveWriter();
+
+	ArchiveWriter(const ArchiveWriter&) = delete;
+	ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Appends a matrix. </summary>
+	/// <details>
+	/// The output of MFCC_HTK::get_feats_batch can be added one utterance at a time as it is
+	/// produced. Throws std::runtime_error on write errors and for unknown parameter kinds.
+	/// </details>
+	///
+	/// <param name="key">		  	The key of the matrix. Must be unique within the archive. </param>
+	/// <param name="data">		  	The features, in the layout chosen in the constructor. </param>
+	/// <param name="samp_period">	(Optional) the sample period in 100 ns units. </param>
+	/// <param name="basic_kind"> 	(Optional) the basic parameter kind, e.g. "MFCC". </param>
+	/// <param name="qualifiers"> 	(Optional) the qualifiers, e.g. {"0", "D", "A"}. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void add(const std::string& key, const arma::mat& data, int32_t samp_period = 100000,
+		const std::string& basic_kind = "USER", const std::set<std::string>& qualifiers = std::set<std::string>());
+
+	void add(const std::string& key, const arma::fmat& data, int32_t samp_period = 100000,
+		const std::string& basic_kind = "USER", const std::set<std::string>& qualifiers = std::set<std::string>());
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Closes the last shard and writes the index. </summary>
+	/// <details>	Throws std::runtime_error on write errors and if a key was added twice. </details>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void close();
+
+	/// <summary>	Number of matrices added. </summary>
+	std::size_t size() const { return entries_.size(); }
+
+private:
+
+	/// <summary>	Where a matrix was written, a record of the index without the key. </summary>
+	struct Entry {
+		uint32_t shard;
+		uint64_t offset;
+		uint64_t bytes;
+		uint32_t frames;
+		uint32_t dims;
+		int32_t samp_period;
+		uint16_t param_kind;
+	};
+
+	/// <summary>	Appends a matrix as an HTK file. </summary>
+	template<typename eT>
+	void add_htk(const std::string& key, const arma::Mat<eT>& data, int32_t samp_period,
+		const std::string& basic_kind, const std::set<std::string>& qualifiers);
+
+	/// <summary>	Pads the shard to 64 bytes and starts a new one when it is full. </summary>
+	void next_entry();
+
+	/// <summary>	Records the matrix just written to the shard. </summary>
+	void finish_entry(const std::string& key, uint32_t frames, uint32_t dims, int32_t samp_period,
+		uint16_t param_kind);
+
+	/// <summary>	Opens the shard with the given number. </summary>
+	void open_shard(uint32_t shard);
+
+	std::string prefix_;
+	ArchiveEncoding encoding_;
+	FeatureLayout layout_;
+	uint64_t shard_size_;
+	std::ofstream shard_;
+	uint32_t shard_index_;
+	uint64_t shard_pos_;
+	uint64_t entry_start_;
+	bool open_;
+
+	/// <summary>	The keys, in the order they were added. </summary>
+	std::vector<std::string> keys_;
+
+	/// <summary>	The entries, in the order they were added. </summary>
+	std::vector<Entry> entries_;
+
+	/// <summary>	The frames of one matrix as floats. </summary>
+	std::vector<float> staging_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Reads an archive written by ArchiveWriter. </summary>
+/// <details>
+/// The index and the shards are memory mapped, so opening an archive only reads the pages that
+/// are used. Keys are found by binary search in the mapped index. The reader is not modified
+/// after construction and can be shared by several threads.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ArchiveReader
+{
+public:
+
+	/// <summary>	A matrix in the archive. </summary>
+	struct Entry {
+		uint32_t shard;
+		uint64_t offset;
+		uint64_t bytes;
+		uint32_t frames;
+		uint32_t dims;
+		int32_t samp_period;
+		uint16_t param_kind;
+		ArchiveEncoding encoding;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Opens an archive. Throws std::runtime_error if it is missing or damaged. </summary>
+	///
+	/// <param name="prefix">	The prefix the archive was written with. </param>
+	/// <param name="layout">	(Optional) the layout of the matrices returned by load. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	explicit ArchiveReader(const std::string& prefix, FeatureLayout layout = FeatureLayout::frame_major);
+
+	/// <summary>	Number of matrices. </summary>
+	std::size_t size() const { return count_; }
+
+	/// <summary>	The i-th key in sorted order. </summary>
+	std::string key(std::size_t i) const;
+
+	/// <summary>	The i-th entry in the order of the keys. </summary>
+	Entry entry(std::size_t i) const;
+
+	/// <summary>	The position of the key in sorted order, or size() if it is missing. </summary>
+	std::size_t find(const std::string& key) const;
+
+	/// <summary>	Whether the archive contains the key. </summary>
+	bool contains(const std::string& key) const { return find(key) != count_; }
+
+	/// <summary>	The stored bytes of an entry, in the mapped shard. </summary>
+	const char* bytes(const Entry& e) const { return shards_[e.shard].data() + e.offset; }
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	A read-only matrix in the mapped memory of a shard, one column per frame. </summary>
+	/// <details>	Only valid as long as the reader. The values are column-major like arma::fmat. </details>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	struct View {
+		const float* mem;
+		arma::uword n_rows;
+		arma::uword n_cols;
+
+		const float* memptr() const { return mem; }
+
+		const float* colptr(arma::uword col) const { return mem + col * n_rows; }
+
+		float operator()(arma::uword row, arma::uword col) const { return mem[row + col * n_rows]; }
+
+		/// <summary>	A copy of the matrix. </summary>
+		arma::fmat mat() const { return mem ? arma::fmat(mem, n_rows, n_cols) : arma::fmat(n_rows, n_cols); }
+	};
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Returns a matrix stored as native_float without copying it. </summary>
+	/// <details>
+	/// The view points into the read-only mapping of the shard and always has one column per
+	/// frame, whatever the layout of the reader. Throws std::runtime_error if the key is missing
+	/// or the matrix is stored as htk.
+	/// </details>
+	///
+	/// <param name="key">	The key. </param>
+	///
+	/// <returns>	The dims x frames matrix. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	View view(const std::string& key) const;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Returns a copy of a matrix in any encoding. </summary>
+	/// <details>	Throws std::runtime_error if the key is missing. </details>
+	///
+	/// <param name="key">	The key. </param>
+	///
+	/// <returns>	The matrix, in the layout chosen in the constructor. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	arma::mat load(const std::string& key) const;
+
+private:
+
+	/// <summary>	The entry of the key, throws std::runtime_error if it is missing. </summary>
+	Entry at(const std::string& key) const;
+
+	std::string prefix_;
+	FeatureLayout layout_;
+	MappedFile index_;
+	std::vector<MappedFile> shards_;
+	std::size_t count_;
+
+	/// <summary>	The records in the mapped index. </summary>
+	const char* records_;
+
+	/// <summary>	The key strings in the mapped index. </summary>
+	const char* strings_;
+	uint64_t strings_size_;
+};
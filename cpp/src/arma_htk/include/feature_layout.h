@@ -0,0 +1,25 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	feature_layout.h
+//
+// summary:	Declares the FeatureLayout enum shared by the extractors and HTKFile
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	How a matrix of features is laid out in (column-major) memory. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum class FeatureLayout {
+
+	/// <summary>
+	/// One column per frame (F x W). The features of a frame are contiguous, in the same order
+	///		as the samples of an HTK file or a row-major frames x features array.
+	/// </summary>
+	frame_major,
+
+	/// <summary>
+	/// One row per frame (W x F). Every feature is contiguous over the frames.
+	/// </summary>
+	feature_major
+};
@@ -0,0 +1,25 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	htk_byte_order.h
+//
+// summary:	Declares the HTKByteOrder enum shared by the HTK file readers and writers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The byte order of the header and the samples of an HTK file. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum class HTKByteOrder {
+
+	/// <summary>
+	/// Big-endian, the format of the HTK tools by default.
+	/// </summary>
+	big_endian,
+
+	/// <summary>
+	/// The byte order of the machine (little-endian on x86 and ARM), as written by the HTK tools
+	/// with NATURALWRITEORDER = T and read with NATURALREADORDER = T. No bytes are swapped.
+	/// </summary>
+	natural
+};
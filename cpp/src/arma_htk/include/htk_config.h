@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	htk_config.h
+//
+// summary:	Declares the HTKConfig class, which reads HTK configuration files such as hcopy.conf
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <set>
+#include <string>
+#include "htk_byte_order.h"
+#include "mfcc_htk.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	How HCopy computes and saves the features of a configuration. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct HCopySettings {
+
+	/// <summary>	The extractor configuration, with filter_compatibility set. </summary>
+	MFCC_HTK_Config mfcc;
+
+	/// <summary>	Number of difference orders to append: 1 for _D, 2 for _A, 3 for _T. </summary>
+	int delta_order = 0;
+
+	/// <summary>	DELTAWINDOW (and ACCWINDOW). </summary>
+	int deltawin = 2;
+
+	/// <summary>	The basic kind of TARGETKIND, e.g. "MFCC". </summary>
+	std::string basic_kind = "MFCC";
+
+	/// <summary>	The qualifiers of TARGETKIND with C and K added for SAVECOMPRESSED and SAVEWITHCRC. </summary>
+	std::set<std::string> qualifiers;
+
+	/// <summary>	TARGETRATE, the sample period of the output in 100 ns units. </summary>
+	int32_t target_rate = 100000;
+
+	/// <summary>	The byte order of the output, natural with NATURALWRITEORDER = T. </summary>
+	HTKByteOrder order = HTKByteOrder::big_endian;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The parameters of an HTK configuration file. </summary>
+/// <details>
+/// Each line holds "NAME = value", optionally preceded by a module name as in
+/// "HPARM: TARGETKIND = MFCC_0". Everything after # is a comment. Names are not case sensitive.
+/// Several files can be read into one configuration, later values replace earlier ones, like
+/// several -C options of the HTK tools.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class HTKConfig
+{
+public:
+
+	/// <summary>	Reads a configuration file. Throws std::runtime_error if it cannot be read. </summary>
+	void load(const std::string& filename);
+
+	/// <summary>	Reads configuration lines. Throws std::runtime_error on syntax errors. </summary>
+	void parse(std::istream& in, const std::string& name = "config");
+
+	/// <summary>	Whether the parameter is set. </summary>
+	bool has(const std::string& name) const;
+
+	/// <summary>	The value of a parameter, or fallback if it is not set. </summary>
+	std::string get(const std::string& name, const std::string& fallback = "") const;
+
+	/// <summary>	A numeric parameter. Throws std::runtime_error if it is not a number. </summary>
+	double get_number(const std::string& name, double fallback) const;
+
+	/// <summary>	A boolean parameter (T, TRUE, F or FALSE). Throws std::runtime_error otherwise. </summary>
+	bool get_bool(const std::string& name, bool fallback) const;
+
+	/// <summary>	Sets a parameter. </summary>
+	void set(const std::string& name, const std::string& value);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Translates the configuration of HCopy to MFCC_HTK. </summary>
+	/// <details>
+	/// Reads SOURCERATE, TARGETRATE, WINDOWSIZE, PREEMCOEF, NUMCHANS, LOFREQ, HIFREQ, NUMCEPS,
+	/// CEPLIFTER, RAWENERGY, ENORMALISE, ESCALE, SILFLOOR, DELTAWINDOW, ACCWINDOW, TARGETKIND,
+	/// SAVECOMPRESSED, SAVEWITHCRC and NATURALWRITEORDER. Throws std::runtime_error for settings
+	/// that MFCC_HTK does not implement, e.g. a TARGETKIND other than MFCC or FBANK,
+	/// USEHAMMING = F, USEPOWER = T, ZMEANSOURCE = T, dithering, SOURCEFORMAT other than NOHEAD
+	/// or different DELTAWINDOW and ACCWINDOW.
+	/// </details>
+	///
+	/// <returns>	The settings. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	HCopySettings hcopy_settings() const;
+
+private:
+
+	/// <summary>	The parameters by upper case name. </summary>
+	std::map<std::string, std::string> values_;
+};
@@ -1,42 +1,153 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // file:	htk_file.h
 //
-// summary:	Declares the CHTKFile class for reading HTK formatted files
+// summary:	Declares the HTKFile_T class for reading and writing HTK formatted files
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <ostream>
 #include <string>
 #include <cstdint>
 #include <set>
 #include <vector>
 #include <armadillo>
+#include "feature_layout.h"
+#include "htk_byte_order.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary> Class to load binary HTK file.
+/// <summary> Class to load and save binary HTK file.
 /// Details on the format can be found online in HTK Book chapter 5.7.1.
 /// Not everything is implemented 100 % , but most features should be supported.
 /// Not implemented:
-/// CRC checking - files can have CRC, but it won't be checked for correctness.
 /// VQ - Vector features are not implemented.
 /// </summary>
+/// <details>
+/// Instantiated for double (HTKFile) and float (HTKFile_F). HTK stores 32-bit floats, so
+/// HTKFile_F holds the samples of a file at their own precision in half the memory. A file in
+/// natural byte order loaded into an HTKFile_F with frame_major layout is a plain copy.
+/// </details>
+///
+/// <typeparam name="eT">	Element type of data(), double or float. </typeparam>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-class HTKFile
+template<typename eT>
+class HTKFile_T
 {
 public:
 
+	typedef arma::Mat<eT> mat_type;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Constructor. </summary>
+	///
+	/// <param name="layout">	(Optional) layout of data(). frame_major (default) stores one column
+	/// 						per sample (F x N) in the order of the file, feature_major stores one
+	/// 						row per sample (N x F). </param>
+	/// <param name="order"> 	(Optional) byte order of the files loaded and saved. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	explicit HTKFile_T(FeatureLayout layout = FeatureLayout::frame_major,
+		HTKByteOrder order = HTKByteOrder::big_endian) : layout_(layout), order_(order) {}
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// <summary>	Loads from given file. </summary>
+	/// <details>	
+	/// The file is memory mapped and its size is checked against the header once. The
+	/// payload is then decoded straight into data(). Throws std::runtime_error if the file is
+	/// shorter than its header says, or if check_crc is set and the CRC of a file with the K 
+	/// qualifier does not match. The CRC is computed 8 bytes at a time with table lookups.
+	/// </details>
+	///
+	/// <param name="filename"> 	The filename of the HTK file to load. </param>
+	/// <param name="check_crc">	(Optional) verify the CRC of files with the K qualifier. </param>
+	///
+	/// <returns>	true if it succeeds, false if the file cannot be opened. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	bool load(const std::string& filename, bool check_crc = false);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Loads the samples [first, last) of given file. </summary>
+	/// <details>	
+	/// Reads the header and maps only the pages holding the requested samples (and the scales A 
+	/// and B of a compressed file), so the cost does not depend on the length of the file. 
+	/// samples() then returns last - first. The CRC is not checked. Throws std::runtime_error if 
+	/// the file is damaged or shorter than its header says, or if the range is not within the 
+	/// file; the object is then left unchanged.
+	/// </details>
 	///
 	/// <param name="filename">	The filename of the HTK file to load. </param>
+	/// <param name="first">   	The first sample to load. </param>
+	/// <param name="last">	   	One past the last sample to load. </param>
+	///
+	/// <returns>	true if it succeeds, false if the file cannot be opened. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	bool load_range(const std::string& filename, int32_t first, int32_t last);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Loads from an HTK file in memory, see load. Throws std::runtime_error on errors. </summary>
+	///
+	/// <param name="data">	    	The bytes of the file. </param>
+	/// <param name="size">	    	Number of bytes. </param>
+	/// <param name="check_crc">	(Optional) verify the CRC of files with the K qualifier. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void load_memory(const char* data, std::size_t size, bool check_crc = false);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Decodes an HTK file in memory into memory of the caller. </summary>
+	/// <details>	
+	/// Like load_memory, but the samples are written to dst instead of data(), which is left 
+	/// empty. Parse the header first (see parse_htk_header) to size dst.
+	/// </details>
+	///
+	/// <param name="data">	    	The bytes of the file. </param>
+	/// <param name="size">	    	Number of bytes. </param>
+	/// <param name="dst">	    	Receives samples() * features() values, laid out like data(). </param>
+	/// <param name="check_crc">	(Optional) verify the CRC of files with the K qualifier. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void load_memory(const char* data, std::size_t size, eT* dst, bool check_crc = false);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Sets the samples and the parameter kind to save. </summary>
+	///
+	/// <param name="data">		  	The samples, in the layout chosen in the constructor. </param>
+	/// <param name="samp_period">	The sample period in 100 ns units. </param>
+	/// <param name="basic_kind"> 	The basic parameter kind, e.g. "MFCC". </param>
+	/// <param name="qualifiers"> 	(Optional) the qualifiers, e.g. {"0", "D", "A"}. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void set_data(const mat_type& data, int32_t samp_period, const std::string& basic_kind,
+		const std::set<std::string>& qualifiers = std::set<std::string>());
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Saves to given file in the format written by HCopy. </summary>
+	/// <details>	
+	/// The samples are stored as floats, or as 16-bit integers for WAVEFORM and IREFC 
+	/// (scaled by 32767, the inverse of load). With the C qualifier every feature is compressed
+	/// to 16 bits with its own scale A and offset B (see HTK Book 5.10). With the K qualifier a
+	/// CRC of the payload is appended. The payload is encoded and written in large blocks.
+	/// </details>
+	///
+	/// <param name="filename">	The filename of the HTK file to write. </param>
 	///
 	/// <returns>	true if it succeeds, false if it fails. </returns>
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	bool load(const std::string& filename);
+	bool save(const std::string& filename) const;
 
-	auto data() const { return data_.t(); }
+	/// <summary>	Writes the file to a binary stream, see save. </summary>
+	void save(std::ostream& out) const;
+
+	/// <summary>	The loaded samples, in the layout chosen in the constructor. </summary>
+	const mat_type& data() const { return data_; }
+
+	FeatureLayout layout() const { return layout_; }
+
+	HTKByteOrder byte_order() const { return order_; }
 	
 	int32_t samples() const { return nSamples_; }
 
@@ -49,7 +160,25 @@ public:
 	const auto& qualifiers() const { return qualifiers_; }
 
 private:
-	arma::mat data_;
+
+	/// <summary>	Reads the 12-byte header. </summary>
+	void parse_header(const char* header);
+
+	/// <summary>	Size of a sample in the file. </summary>
+	std::size_t sample_bytes() const;
+
+	/// <summary>	Size of the scales A and B ahead of the samples of a compressed file. </summary>
+	std::size_t scale_bytes() const;
+
+	/// <summary>	Loads from memory into dst, or into data_ if dst is null. </summary>
+	void read_memory(const char* data, std::size_t size, bool check_crc, eT* dst);
+
+	/// <summary>	Decodes count samples into mem, or into data_ if mem is null. </summary>
+	void decode_samples(const char* scales, const char* samples, int32_t count, eT* mem);
+
+	FeatureLayout layout_;
+	HTKByteOrder order_;
+	mat_type data_;
 	int32_t nSamples_;
 	int32_t nFeatures_;
 	int32_t sampPeriod_;
@@ -57,3 +186,8 @@ private:
 	std::set<std::string> qualifiers_;
 };
 
+/// <summary>	HTK file with double precision samples. </summary>
+typedef HTKFile_T<double> HTKFile;
+
+/// <summary>	HTK file with single precision samples. </summary>
+typedef HTKFile_T<float> HTKFile_F;
@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	htk_probe.h
+//
+// summary:	Declares functions that read only the headers of HTK files, to index large corpora
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "htk_byte_order.h"
+
+/// <summary>	Bits of the parameter kind in the HTK header, see HTK Book 5.10. </summary>
+namespace htk_kind {
+
+	/// <summary>	The bits of the basic kind, e.g. 6 for MFCC. </summary>
+	const uint16_t basic_mask = 077;
+
+	const uint16_t WAVEFORM = 0;
+	const uint16_t IREFC = 5;
+	const uint16_t MFCC = 6;
+	const uint16_t FBANK = 7;
+	const uint16_t USER = 9;
+	const uint16_t PLP = 11;
+
+	const uint16_t E = 0100;
+	const uint16_t N = 0200;
+	const uint16_t D = 0400;
+	const uint16_t A = 01000;
+	const uint16_t C = 02000;
+	const uint16_t Z = 04000;
+	const uint16_t K = 010000;
+	const uint16_t Zero = 020000;
+	const uint16_t V = 040000;
+	const uint16_t T = 0100000;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The 12-byte header of an HTK file. </summary>
+/// <details>
+/// The parameter kind is kept as the bitmask of the file, test qualifiers with the htk_kind
+/// constants, e.g. header.has(htk_kind::D).
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct HTKHeader
+{
+	/// <summary>	Number of samples (frames), without the scales of a compressed file. </summary>
+	int32_t samples;
+
+	/// <summary>	The sample period in 100 ns units. </summary>
+	int32_t samp_period;
+
+	/// <summary>	Number of bytes per sample in the file. </summary>
+	uint16_t sample_size;
+
+	/// <summary>	The parameter kind: basic kind and qualifier bits. </summary>
+	uint16_t param_kind;
+
+	/// <summary>	The basic kind, param_kind &amp; htk_kind::basic_mask. </summary>
+	uint16_t basic_kind() const { return param_kind & htk_kind::basic_mask; }
+
+	/// <summary>	Whether all the given qualifier bits are set. </summary>
+	bool has(uint16_t qualifiers) const { return (param_kind & qualifiers) == qualifiers; }
+
+	/// <summary>	Number of features per sample. </summary>
+	int features() const;
+
+	/// <summary>	The parameter kind as written by HList, e.g. "MFCC_D_A_0". </summary>
+	std::string kind_name() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Decodes a header. </summary>
+///
+/// <param name="data">  	The 12 bytes at the start of an HTK file. </param>
+/// <param name="header">	Receives the header. </param>
+/// <param name="order"> 	(Optional) the byte order of the file. </param>
+///
+/// <returns>	false if the header is invalid (negative number of samples). </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool parse_htk_header(const char* data, HTKHeader& header, HTKByteOrder order = HTKByteOrder::big_endian);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Reads the header of an HTK file without reading any samples. </summary>
+/// <details>	Only the first 12 bytes are read, the size of the file is not checked. </details>
+///
+/// <param name="filename">	The filename of the HTK file. </param>
+/// <param name="header">  	Receives the header. </param>
+/// <param name="order">   	(Optional) the byte order of the file. </param>
+///
+/// <returns>	false if the file cannot be read or the header is invalid. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool probe_htk(const std::string& filename, HTKHeader& header, HTKByteOrder order = HTKByteOrder::big_endian);
+
+/// <summary>	A file found by scan_htk. </summary>
+struct HTKManifestEntry
+{
+	std::string path;
+	HTKHeader header;
+
+	/// <summary>	Whether the header could be read, header is undefined otherwise. </summary>
+	bool ok;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Reads the headers of many HTK files in parallel. </summary>
+/// <details>
+/// Reading headers mostly waits for the file system, so more threads than cores can help,
+/// especially on network file systems.
+/// </details>
+///
+/// <param name="paths">  	The files. </param>
+/// <param name="threads">	(Optional) number of threads, 0 for one per hardware thread. </param>
+/// <param name="order">  	(Optional) the byte order of the files. </param>
+///
+/// <returns>	One entry per file, in the order of paths. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<HTKManifestEntry> scan_htk(const std::vector<std::string>& paths, int threads = 0,
+	HTKByteOrder order = HTKByteOrder::big_endian);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Lists the files below a directory. Throws std::runtime_error if it cannot be read. </summary>
+///
+/// <param name="dir">		The directory, searched recursively. Symlinked directories are not followed. </param>
+/// <param name="extension">	(Optional) only list files ending in this, "" for all files. </param>
+///
+/// <returns>	The paths of the files, sorted. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> list_htk_dir(const std::string& dir, const std::string& extension = ".htk");
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Reads a script file as passed to the HTK tools with -S. </summary>
+/// <details>
+/// One path per line. Empty lines are skipped. For lines of the form "src dst" (as used by
+/// HCopy) the last path is taken. Throws std::runtime_error if the file cannot be read.
+/// </details>
+///
+/// <param name="filename">	The script file. </param>
+///
+/// <returns>	The paths. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> read_htk_script(const std::string& filename);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Writes a manifest of the files that could be read. </summary>
+/// <details>
+/// One line per file with tab separated path, samples, features, sample period and parameter
+/// kind, e.g. "a.htk	312	39	100000	MFCC_D_A_0".
+/// </details>
+///
+/// <param name="out">	  	The stream to write to. </param>
+/// <param name="entries">	The result of scan_htk. </param>
+///
+/// <returns>	Number of files written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t write_htk_manifest(std::ostream& out, const std::vector<HTKManifestEntry>& entries);
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	htk_writer.h
+//
+// summary:	Declares the HTKWriter class for writing HTK files frame by frame
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <armadillo>
+#include "feature_layout.h"
+#include "htk_byte_order.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Writes an HTK file whose length is not known in advance. </summary>
+/// <details>
+/// Samples are encoded into large blocks as they arrive. Full blocks are written by a background
+/// thread, so the caller only waits for the disk when several blocks are pending. The number of
+/// samples in the header, and the CRC with the K qualifier, are written by close().
+///
+/// The file is the same as the one HTKFile::save writes for the same samples. Compression (the
+/// C qualifier) needs the range of every feature over the whole file and is not supported.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class HTKWriter
+{
+public:
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Creates the file, or opens it to add samples at its end. </summary>
+	/// <details>	
+	/// Throws std::runtime_error if the file cannot be opened, if the qualifiers contain C or V,
+	/// or if an existing file to append to has a different parameter kind, sample size or sample
+	/// period.
+	/// </details>
+	///
+	/// <param name="filename">   	The filename of the HTK file. </param>
+	/// <param name="features">   	Number of features per sample. </param>
+	/// <param name="samp_period">	The sample period in 100 ns units. </param>
+	/// <param name="basic_kind"> 	The basic parameter kind, e.g. "MFCC". </param>
+	/// <param name="qualifiers"> 	(Optional) the qualifiers, e.g. {"0", "D", "A"}. </param>
+	/// <param name="append">	  	(Optional) keep the samples of an existing file and add new ones
+	/// 							after them. A missing file is created. </param>
+	/// <param name="order">	  	(Optional) the byte order of the file. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	HTKWriter(const std::string& filename, int features, int32_t samp_period, const std::string& basic_kind,
+		const std::set<std::string>& qualifiers = std::set<std::string>(), bool append = false,
+		HTKByteOrder order = HTKByteOrder::big_endian);
+
+	/// <summary>	Destructor. Closes the file, see close(). Errors are ignored. </summary>
+	~HTKWriter();
+
+	HTKWriter(const HTKWriter&) = delete;
+	HTKWriter& operator=(const HTKWriter&) = delete;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Appends one sample. </summary>
+	///
+	/// <param name="sample">	The features() values of the sample. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void write(const double* sample);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Appends samples. </summary>
+	///
+	/// <param name="samples">	The samples. </param>
+	/// <param name="layout"> 	(Optional) the layout of samples: one column per sample (default)
+	/// 						or one row per sample. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void write(const arma::mat& samples, FeatureLayout layout = FeatureLayout::frame_major);
+
+	/// <summary>	Appends single precision samples, e.g. of MFCC_HTK_F. </summary>
+	void write(const arma::fmat& samples, FeatureLayout layout = FeatureLayout::frame_major);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Writes the pending samples, completes the header and the CRC and closes the file. </summary>
+	/// <details>	Throws std::runtime_error if writing failed. Does nothing if already closed. </details>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void close();
+
+	/// <summary>	Number of samples in the file, including those written before an append. </summary>
+	int32_t samples() const { return samples_; }
+
+	/// <summary>	Number of features per sample. </summary>
+	int features() const { return features_; }
+
+private:
+
+	/// <summary>	Hands the current block to the background thread. </summary>
+	void submit();
+
+	/// <summary>	The background thread main loop. </summary>
+	void flusher();
+
+	std::fstream file_;
+
+	/// <summary>	Whether the bytes are swapped, false in natural byte order. </summary>
+	bool swap_;
+
+	int features_;
+	bool shorts_;
+	bool crc_;
+	std::size_t sample_size_;
+	int32_t samples_;
+	bool open_;
+
+	/// <summary>	The block being filled by the caller. </summary>
+	std::vector<char> block_;
+	std::vector<int16_t> codes_;
+	std::vector<double> row_;
+
+	/// <summary>	The CRC of the payload written so far, owned by the background thread. </summary>
+	uint16_t sum_;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::vector<char>> pending_;
+	std::vector<std::vector<char>> spare_;
+	bool closing_;
+	std::exception_ptr error_;
+};
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	mapped_file.h
+//
+// summary:	Declares the MappedFile class, a read-only memory mapping of a whole file
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Maps a whole file read-only into memory. </summary>
+/// <details>
+/// The pages are read by the OS on first access, so nothing is copied up front and the samples
+/// of a large file are only read once, by the code that uses them. The mapping stays valid until
+/// the object is destroyed. Uses mmap on POSIX systems and file mappings on Windows.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class MappedFile
+{
+public:
+
+	/// <summary>	Creates an empty mapping. </summary>
+	MappedFile() : data_(nullptr), size_(0), base_(nullptr), mapped_(0) {}
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Maps the given file. Throws std::runtime_error if it cannot be opened. </summary>
+	///
+	/// <param name="filename">	The file to map. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	explicit MappedFile(const std::string& filename);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Maps a part of the given file. </summary>
+	/// <details>	
+	/// Only the pages around the given bytes are mapped. Throws std::runtime_error if the file 
+	/// cannot be opened or is shorter than offset + length.
+	/// </details>
+	///
+	/// <param name="filename">	The file to map. </param>
+	/// <param name="offset">  	The first byte to map. </param>
+	/// <param name="length">  	Number of bytes to map. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	MappedFile(const std::string& filename, std::size_t offset, std::size_t length);
+
+	/// <summary>	Destructor. Unmaps the file. </summary>
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other);
+	MappedFile& operator=(MappedFile&& other);
+
+	/// <summary>	The mapped bytes (null if there are none). </summary>
+	const char* data() const { return data_; }
+
+	/// <summary>	Number of mapped bytes, the size of the file unless only a part is mapped. </summary>
+	std::size_t size() const { return size_; }
+
+	/// <summary>	The file as an array of T (a whole file mapping is page aligned). </summary>
+	template<typename T>
+	const T* as() const { return reinterpret_cast<const T*>(data_); }
+
+	/// <summary>	Number of whole elements of type T in the file. </summary>
+	template<typename T>
+	std::size_t count() const { return size_ / sizeof(T); }
+
+private:
+
+	/// <summary>	Maps length bytes at offset, or the whole file if whole is set. </summary>
+	void open(const std::string& filename, std::size_t offset, std::size_t length, bool whole);
+
+	/// <summary>	Unmaps the file. </summary>
+	void close();
+
+	const char* data_;
+	std::size_t size_;
+
+	/// <summary>	The start of the mapping, aligned down from data_ to the mapping granularity. </summary>
+	void* base_;
+	std::size_t mapped_;
+};
@@ -8,10 +8,198 @@
 #include <string>
 #include <iostream>
 #include <memory>
+#include <vector>
+#include <functional>
 #include <armadillo>
+#include "feature_layout.h"
+#include "real_fft.h"
+#include "thread_pool.h"
 
 using namespace std::string_literals;
 
+template<typename eT> class OnlineMFCC_HTK_T;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	HTK configuration of MFCC_HTK_T. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct MFCC_HTK_Config {
+
+	/// <summary>
+	/// filter_compatibility (boolean):
+	/// 	load the filter specification similar to HTK. This exists to allow binary comaptibility with
+	/// 	HTK, because they implement the filters slightly differently than mentioned in their docs.
+	/// 
+	/// If you set filter_compatibility to false, a built-in method will be used to create half -
+	///		overlapping triangular filters spread evenly between lo_freq and hi_freq in the mel domain.
+	/// </summary>
+	bool filter_compatibility = false;
+
+	/// <summary>
+	/// win_len(int) : Length of frame in samples. Default value is 400, which is
+	///		equal to 25 ms for a signal sampled at 16 kHz (i.e. 2.5x the win_shift length)
+	/// Equivalent: WINDOWSIZE divided by SOURCERATE.
+	/// </summary>
+	int win_len = 400;
+
+	/// <summary>
+	/// win_shift(int) : Frame shift in samples - in other words, distance between
+	///		the start of two consecutive frames. Default value is 160, which is equal to 10 ms for a
+	///		signal sampled at 16 kHz. This is generates 100 frames per second of the audio, which is a
+	///		standard framerate for many audio tasks. 
+	/// Equivalent: TARGETRATE divided by SOURCERATE.
+	/// </summary>
+	int win_shift = 160;
+
+	/// <summary>
+	/// preemph(float) : Preemphasis coefficient.This is used to calculate 
+	///		first-order difference of the signal. 
+	/// Equivalent: PREEMCOEF.
+	/// </summary>
+	float preemph = 0.97f;
+
+	/// <summary>
+	/// filter_num(int) : Number of triangular filters used to reduce the spectrum. 
+	///		Default value is 26. 
+	/// Equivalent: NUMCHANS.
+	/// </summary>
+	int filter_num = 26;
+
+
+	/// <summary>
+	/// lifter_num(int) : Default value is 22.
+	/// Equivalent: CEPLIFTER.
+	/// </summary>
+	int lifter_num = 22;
+
+	/// <summary>
+	/// mfcc_num(int) : Number of MFCCs computed.Default value is 12.
+	/// Equivalent: NUMCEPS.
+	/// </summary>
+	int mfcc_num = 12;
+
+	/// <summary>
+	/// lo_freq(float) : Lowest frequency(in Hz) used in computation. Default value is
+	///		0 Hz. This is used exclusively to compute filters. 
+	/// Equivalent: LOFREQ.
+	/// </summary>
+	int lo_freq = -1;
+
+	/// <summary>
+	/// hi_freq(float) : Highest frequency(in Hz) used in computation. 
+	///		Default value is the Nyquist frequency. This is used exclusively 
+	///		to compute filters. 
+	/// Equivalent: HIFREQ.
+	/// </summary>
+	int hi_freq = -1;
+
+	/// <summary>
+	/// samp_freq(int) : Sampling frequency of the audio. Default value
+	///		is 16000, which is a common value for recording speech. Due to 
+	///		Nyquist, the maximum frequency stored is half of this value, i.e. 8000 Hz.
+	///	Equivalent: 10^7 / SOURCERATE
+	/// </summary>
+	int samp_freq = 16000;
+
+	/// <summary> raw_energy(boolean) : Should the energy be computed from
+	///		the raw signal, or (if false) should the 0'th coepstral coefficient
+	///		be used instead, which is almost equivalent and much faster to 
+	///		compute (since we compute MFCC anyway).
+	///	Equivalent: RAWENERGY
+	/// </summary>
+	bool raw_energy = false;
+	
+        /// <summary>
+        /// feat_melspec(boolean) : Should the spectral features be added to 
+        ///		output. These are the values of the logarithm of the filter outputs.
+        ///		The number of these features is eqeual to filter_num.
+        /// </summary>
+        bool feat_melspec = false;
+
+	/// <summary>	
+	/// feat_mfcc(boolean) : Should MFCCs be added to the output.
+	///		The number of these features is equal to mfcc_num.
+	///	</summary>
+	bool feat_mfcc = true;
+
+	/// <summary>
+	/// feat_energy(boolean) : Should energy be added to the output.
+	///		This is a single value.
+	/// </summary>
+	bool feat_energy = true;
+        
+	/// <summary>
+	/// ceps_energy (boolean): Energy is calculated from the 0th cepstral 
+	///		coefficient. Default is true.
+	///	Equivalent: true equals to option _0 in HTK; false equals to _E.
+	/// </summary>
+	bool ceps_energy = true;
+
+	/// <summary>	enormalise (boolean): subtract max value of energy 
+	///		and add 1.0. Only applied to normal (non cepstral) energy. 
+	///		(default false). 
+	///	Equivalent: ENORMALISE
+	/// </summary>
+	bool enormalise = false;
+
+	/// <summary> 
+	/// sil_floor (float, dB): The lowest energy in the utterance can be 
+	///		clamped using this configuration parameter which gives the ratio 
+	///		between the maximum and minimum energies in the utterance in dB. 
+	///		(default 50). 
+	/// </summary>
+	float sil_floor = 50.0f;
+
+	/// <summary> 
+	/// escale (float): scale energy by this value. 
+	///		only applied to normal (non cepstral) energy. 
+	///	Equivalent: ESCALE
+	/// </summary>
+	float escale = 1.0f;
+
+	/// <summary> perform Cepstral Mean Normalization - 
+	///		subtract utterance mean from cepstral coefficients only. 
+	/// Equivalent: _Z in HTK options. (default false). 
+	/// </summary>
+	bool cmn = false;
+
+	/// <summary>
+	/// block_frames (int): Number of frames framed into one matrix and pushed through
+	///		the FFT, the filterbank and the DCT together. The filterbank and the DCT then
+	///		run as single matrix products (BLAS GEMM). The default keeps a block of frames
+	///		and its spectra within a typical L2 cache. A value of 1 processes the signal
+	///		frame by frame. 
+	/// </summary>
+	int block_frames = 32;
+
+	/// <summary>
+	/// sparse_filter (boolean): Apply the filterbank as a sparse map instead of a dense 
+	///		matrix product. Every FFT bin feeds at most two adjacent channels, so the 
+	///		filterbank is stored as a channel index and two weights per bin and applied 
+	///		in one pass over the bins between the lowest and the highest cut-off. 
+	///		Works with both filter layouts (see filter_compatibility). If the filters 
+	///		overlap more than that, the dense product is used instead.
+	/// </summary>
+	bool sparse_filter = false;
+
+	/// <summary>
+	/// num_threads (int): Number of threads computing the frames of one utterance in get_feats,
+	///		including the calling thread. 0 uses one thread per hardware thread. The frames are
+	///		split into the same blocks for every thread count and the per-utterance sums and 
+	///		maxima are combined in block order, so the output does not depend on this value.
+	/// </summary>
+	int num_threads = 1;
+
+	/// <summary>
+	/// layout (FeatureLayout): Layout of the matrices returned by get_feats and get_delta and
+	///		expected by get_delta. frame_major (default) returns F x W with one column per frame,
+	///		feature_major returns W x F with one row per frame. The output is written in the
+	///		chosen layout block by block, so neither layout needs a transpose of the whole
+	///		utterance. The values are the same in both layouts.
+	/// </summary>
+	FeatureLayout layout = FeatureLayout::frame_major;
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary>	Class to compute HTK compatible MFCC features from audio. </summary>
 /// <details>
@@ -29,157 +217,27 @@ using namespace std::string_literals;
 ///	have problems with this code).
 ///
 ///	For more information about HTK go to http ://htk.eng.cam.ac.uk/
+///
+/// The class is instantiated for double (MFCC_HTK) and float (MFCC_HTK_F). The float
+/// instantiation keeps the signal, the FFT, the filterbank, the DCT, the deltas and the 
+/// output in single precision. HTK itself stores parameters as 32-bit floats.
 /// </details>
+///
+/// <typeparam name="eT">	Element type, double or float. </typeparam>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-class MFCC_HTK
+template<typename eT>
+class MFCC_HTK_T
 {
 public:
 
-	////////////////////////////////////////////////////////////////////////////////////////////////////
-	/// <summary>	HTK configuration </summary>
-	////////////////////////////////////////////////////////////////////////////////////////////////////
-
-	struct Config {
-
-		/// <summary>
-		/// filter_compatibility (boolean):
-		/// 	load the filter specification similar to HTK. This exists to allow binary comaptibility with
-		/// 	HTK, because they implement the filters slightly differently than mentioned in their docs.
-		/// 
-		/// If you set filter_compatibility to false, a built-in method will be used to create half -
-		///		overlapping triangular filters spread evenly between lo_freq and hi_freq in the mel domain.
-		/// </summary>
-		bool filter_compatibility = false;
-
-		/// <summary>
-		/// win_len(int) : Length of frame in samples. Default value is 400, which is
-		///		equal to 25 ms for a signal sampled at 16 kHz (i.e. 2.5x the win_shift length)
-		/// Equivalent: WINDOWSIZE divided by SOURCERATE.
-		/// </summary>
-		int win_len = 400;
-
-		/// <summary>
-		/// win_shift(int) : Frame shift in samples - in other words, distance between
-		///		the start of two consecutive frames. Default value is 160, which is equal to 10 ms for a
-		///		signal sampled at 16 kHz. This is generates 100 frames per second of the audio, which is a
-		///		standard framerate for many audio tasks. 
-		/// Equivalent: TARGETRATE divided by SOURCERATE.
-		/// </summary>
-		int win_shift = 160;
-
-		/// <summary>
-		/// preemph(float) : Preemphasis coefficient.This is used to calculate 
-		///		first-order difference of the signal. 
-		/// Equivalent: PREEMCOEF.
-		/// </summary>
-		float preemph = 0.97f;
-
-		/// <summary>
-		/// filter_num(int) : Number of triangular filters used to reduce the spectrum. 
-		///		Default value is 26. 
-		/// Equivalent: NUMCHANS.
-		/// </summary>
-		int filter_num = 26;
-
-
-		/// <summary>
-		/// lifter_num(int) : Default value is 22.
-		/// Equivalent: CEPLIFTER.
-		/// </summary>
-		int lifter_num = 22;
-
-		/// <summary>
-		/// mfcc_num(int) : Number of MFCCs computed.Default value is 12.
-		/// Equivalent: NUMCEPS.
-		/// </summary>
-		int mfcc_num = 12;
-
-		/// <summary>
-		/// lo_freq(float) : Lowest frequency(in Hz) used in computation. Default value is
-		///		0 Hz. This is used exclusively to compute filters. 
-		/// Equivalent: LOFREQ.
-		/// </summary>
-		int lo_freq = -1;
-
-		/// <summary>
-		/// hi_freq(float) : Highest frequency(in Hz) used in computation. 
-		///		Default value is the Nyquist frequency. This is used exclusively 
-		///		to compute filters. 
-		/// Equivalent: HIFREQ.
-		/// </summary>
-		int hi_freq = -1;
-
-		/// <summary>
-		/// samp_freq(int) : Sampling frequency of the audio. Default value
-		///		is 16000, which is a common value for recording speech. Due to 
-		///		Nyquist, the maximum frequency stored is half of this value, i.e. 8000 Hz.
-		///	Equivalent: 10^7 / SOURCERATE
-		/// </summary>
-		int samp_freq = 16000;
-
-		/// <summary> raw_energy(boolean) : Should the energy be computed from
-		///		the raw signal, or (if false) should the 0'th coepstral coefficient
-		///		be used instead, which is almost equivalent and much faster to 
-		///		compute (since we compute MFCC anyway).
-		///	Equivalent: RAWENERGY
-		/// </summary>
-		bool raw_energy = false;
-		
-        /// <summary>
-        /// feat_melspec(boolean) : Should the spectral features be added to 
-        ///		output. These are the values of the logarithm of the filter outputs.
-        ///		The number of these features is eqeual to filter_num.
-        /// </summary>
-        bool feat_melspec = false;
+	/// <summary>	The configuration type, shared by both precisions. </summary>
+	typedef MFCC_HTK_Config Config;
 
-		/// <summary>	
-		/// feat_mfcc(boolean) : Should MFCCs be added to the output.
-		///		The number of these features is equal to mfcc_num.
-		///	</summary>
-		bool feat_mfcc = true;
-
-		/// <summary>
-		/// feat_energy(boolean) : Should energy be added to the output.
-		///		This is a single value.
-		/// </summary>
-		bool feat_energy = true;
-        
-		/// <summary>
-		/// ceps_energy (boolean): Energy is calculated from the 0th cepstral 
-		///		coefficient. Default is true.
-		///	Equivalent: true equals to option _0 in HTK; false equals to _E.
-		/// </summary>
-		bool ceps_energy = true;
-
-		/// <summary>	enormalise (boolean): subtract max value of energy 
-		///		and add 1.0. Only applied to normal (non cepstral) energy. 
-		///		(default false). 
-		///	Equivalent: ENORMALISE
-		/// </summary>
-		bool enormalise = false;
-
-		/// <summary> 
-		/// sil_floor (float, dB): The lowest energy in the utterance can be 
-		///		clamped using this configuration parameter which gives the ratio 
-		///		between the maximum and minimum energies in the utterance in dB. 
-		///		(default 50). 
-		/// </summary>
-		float sil_floor = 50.0f;
-
-		/// <summary> 
-		/// escale (float): scale energy by this value. 
-		///		only applied to normal (non cepstral) energy. 
-		///	Equivalent: ESCALE
-		/// </summary>
-		float escale = 1.0f;
-
-		/// <summary> perform Cepstral Mean Normalization - 
-		///		subtract utterance mean from cepstral coefficients only. 
-		/// Equivalent: _Z in HTK options. (default false). 
-		/// </summary>
-		bool cmn = false;
-	};
+	typedef eT elem_type;
+	typedef arma::Col<eT> vec_type;
+	typedef arma::Row<eT> rowvec_type;
+	typedef arma::Mat<eT> mat_type;
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// <summary>	Constructor. </summary>
@@ -187,7 +245,7 @@ public:
 	/// <param name="config">	The configuration. </param>
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	MFCC_HTK(const Config& config);
+	MFCC_HTK_T(const Config& config);
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// <summary>	
@@ -201,7 +259,7 @@ public:
 	/// <returns>	vector of raw signal. </returns>
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	arma::vec load_raw_signal(std::string filename);
+	vec_type load_raw_signal(std::string filename);
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// <summary>	
@@ -211,18 +269,73 @@ public:
 	/// <param name="signal">	The audio signal. </param>
 	///
 	/// <returns>	
-	/// A WxF matrix, where W is the number of windows in the signal and F is the number of chosen 
-	/// features.
+	/// An FxW matrix (WxF with FeatureLayout::feature_major), where W is the number of windows in 
+	/// the signal and F is the number of chosen features.
 	///	</returns>
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	arma::mat get_feats(arma::vec signal);
+	mat_type get_feats(const vec_type& signal);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Gets the features of 16-bit PCM samples, see get_feats. </summary>
+	/// <details>	
+	/// The samples are read in place and converted to the working precision frame by frame, so
+	/// the signal is never copied as a whole. Gives the same features as get_feats on the 
+	/// samples converted to vec_type.
+	/// </details>
+	///
+	/// <param name="samples">	The samples. </param>
+	/// <param name="n">	  	Number of samples. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	mat_type get_feats(const arma::s16* samples, arma::uword n);
+
+	/// <summary>	Gets the features of float samples read in place, see get_feats. </summary>
+	mat_type get_feats(const float* samples, arma::uword n);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Gets the features of a RAW signal file without loading it. </summary>
+	/// <details>	
+	/// The file is memory mapped (see MappedFile) and read in place as 16-bit signed samples in
+	/// native byte order, like load_raw_signal. Throws std::runtime_error if it cannot be opened.
+	/// </details>
+	///
+	/// <param name="filename">	Filename of the raw signal file. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	mat_type get_feats_raw(const std::string& filename);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Gets the features of many audio signals at once. </summary>
+	/// <details>
+	/// The signals are spread over the threads of Config::num_threads with work stealing, the 
+	/// longest signals first. Each thread reuses its scratch buffers across signals and each 
+	/// signal is computed on a single thread, so the results equal those of get_feats.
+	/// </details>
+	///
+	/// <param name="signals">	The audio signals. </param>
+	///
+	/// <returns>	The features of every signal, in input order. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	std::vector<mat_type> get_feats_batch(const std::vector<vec_type>& signals);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Gets the features of many RAW signal files at once, see get_feats_batch. </summary>
+	///
+	/// <param name="filenames">	Filenames of the raw signal files (see get_feats_raw). The file
+	/// 							sizes decide which files are started first. </param>
+	///
+	/// <returns>	The features of every file, in input order. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	std::vector<mat_type> get_feats_batch(const std::vector<std::string>& filenames);
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// <summary>	Computes delta using the HTK method. </summary>
 	///
-	/// <param name="feat"> Matrix of shape WxF, where W is number of frames
-	///	and F is number of features.. </param>
+	/// <param name="feat"> Matrix of shape FxW (WxF with FeatureLayout::feature_major), where W is 
+	///	number of frames and F is number of features.. </param>
 	/// <param name="deltawin">	(Optional) the DELTAWINDOW parameter of the delta computation.
 	///	Check HTK Book Chapter 5.6 for details.. </param>
 	/// 
@@ -231,10 +344,87 @@ public:
 	/// </returns>
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	arma::mat get_delta(arma::mat feat, int deltawin = 2);
+	mat_type get_delta(const mat_type& feat, int deltawin = 2);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Appends deltas, accelerations and higher differences to the features. </summary>
+	/// <details>
+	/// Computes the same values as chaining get_delta order times and stacking the results under
+	/// the statics, but in a single pass over the frames and straight into one output matrix.
+	/// Frame t of order l is computed as soon as frame t + deltawin of order l - 1 is known, so
+	/// the frames in use stay in cache. Frames beyond the ends of the utterance are replicated
+	/// from the first and last frame, which only takes extra work at the deltawin frames next to
+	/// each end.
+	/// </details>
+	///
+	/// <param name="feat">	   	The features, see get_delta. </param>
+	/// <param name="deltawin">	(Optional) the DELTAWINDOW (and ACCWINDOW) parameter. </param>
+	/// <param name="order">   	(Optional) number of differences appended: 1 for _D, 2 for _D_A, 3
+	/// 						for _D_A_T. 0 returns a copy of feat. </param>
+	///
+	/// <returns>	
+	/// A (order+1)FxW matrix (Wx(order+1)F with FeatureLayout::feature_major) with the statics, 
+	/// the deltas, the accelerations and so on of every frame.
+	/// </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	mat_type append_deltas(const mat_type& feat, int deltawin = 2, int order = 2);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the delta of a single frame, see get_delta. </summary>
+	///
+	/// <param name="cols">	   	2 * deltawin + 1 pointers to the frames t - deltawin ... t + deltawin,
+	/// 						already clamped to the first and last frame of the utterance. </param>
+	/// <param name="n">	   	Number of features per frame. </param>
+	/// <param name="deltawin">	The DELTAWINDOW parameter. </param>
+	/// <param name="out">	   	Receives the n deltas of frame t. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	static void delta_frame(const eT* const* cols, arma::uword n, int deltawin, eT* out);
+
+	/// <summary>	The configuration, after lo/hi frequency and filter count fix-ups. </summary>
+	const Config& config() const { return config_; }
+
+	/// <summary>	Number of features per frame returned by get_feats. </summary>
+	int feat_num() const { return feat_num_; }
 
 private:
 
+	template<typename> friend class OnlineMFCC_HTK_T;
+
+	/// <summary>	Scratch buffers of a thread, reused across blocks and signals. </summary>
+	struct Workspace {
+		mat_type frames;
+		mat_type spec;
+		mat_type melspec;
+		mat_type mfcc;
+		rowvec_type energy;
+		std::vector<typename RealFFT<eT>::cx_type> fft_work;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the features of a signal, see get_feats. </summary>
+	///
+	/// <typeparam name="S">	Sample type, converted to eT frame by frame. </typeparam>
+	/// <param name="signal"> 	The audio signal. </param>
+	/// <param name="sig_len">	Number of samples. </param>
+	/// <param name="pool">   	The threads computing the blocks of frames, or null. </param>
+	/// <param name="ws">	  	Array with one workspace per thread of the pool (one if pool is null). </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	template<typename S>
+	mat_type compute_feats(const S* signal, arma::uword sig_len, ThreadPool* pool, Workspace* ws) const;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Runs fn for every item of a batch on the pool, the longest items first. </summary>
+	///
+	/// <param name="lengths">	The length of every item. </param>
+	/// <param name="fn">	  	Computes the features of an item with the given workspace. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	std::vector<mat_type> compute_batch(const std::vector<arma::uword>& lengths,
+		const std::function<mat_type(std::size_t, Workspace&)>& fn) const;
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// <summary>	
 	/// Creates filter spec to reproduce an HTK bug.
@@ -252,25 +442,115 @@ private:
 
 	void create_filter();
 
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	
+	/// Creates the sparse form of the filter matrix. Must be called after create_filter_htk or
+	/// create_filter. Leaves the sparse form empty if some bin feeds more than two adjacent channels.
+	/// </summary>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void create_sparse_filter();
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the delta of frame t of a frame-major matrix. </summary>
+	///
+	/// <param name="src">	   	The features of frame 0. </param>
+	/// <param name="stride">  	Distance between the features of consecutive frames. </param>
+	/// <param name="n">	   	Number of features per frame. </param>
+	/// <param name="win_num"> 	Number of frames. </param>
+	/// <param name="t">	   	The frame. </param>
+	/// <param name="deltawin">	The DELTAWINDOW parameter. </param>
+	/// <param name="cols">	   	Scratch for 2 * deltawin + 1 frame pointers. </param>
+	/// <param name="out">	   	Receives the n deltas of frame t. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	static void delta_at(const eT* src, arma::uword stride, arma::uword n, arma::uword win_num,
+		arma::uword t, int deltawin, const eT** cols, eT* out);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the deltas of a single feature over all frames. </summary>
+	///
+	/// <param name="x">	   	The feature in win_num consecutive frames. </param>
+	/// <param name="win_num"> 	Number of frames. </param>
+	/// <param name="deltawin">	The DELTAWINDOW parameter. </param>
+	/// <param name="out">	   	Receives the win_num deltas. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	static void delta_series(const eT* x, arma::uword win_num, int deltawin, eT* out);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the features of a block of consecutive frames. </summary>
+	///
+	/// <param name="signal">	The samples of the audio signal, converted to eT while framing. </param>
+	/// <param name="first"> 	Index of the first frame of the block. </param>
+	/// <param name="count"> 	Number of frames in the block. </param>
+	/// <param name="out">   	The output matrix in the configured layout, receives frames first ...
+	/// 						first + count - 1. </param>
+	/// <param name="ws">	 	Scratch buffers. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	template<typename S>
+	void compute_block(const S* signal, arma::uword first, arma::uword count, mat_type& out, Workspace& ws) const;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the features of already framed windows. </summary>
+	///
+	/// <param name="frames">	The raw frames, one per column. Overwritten with scratch data. </param>
+	/// <param name="first"> 	The output column of the first frame. </param>
+	/// <param name="out">   	The output matrix, receives frames first ... first + frames.n_cols - 1. </param>
+	/// <param name="ws">	 	Scratch buffers. </param>
+	/// <param name="layout">	The layout of out. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void process_frames(mat_type& frames, arma::uword first, mat_type& out, Workspace& ws,
+		FeatureLayout layout) const;
+
 
 	/// <summary>	The configuration. </summary>
 	Config config_;
 	
 	/// <summary>	Length of the FFT. </summary>
 	int fft_len_;
+
+	/// <summary>	The FFT plan, built once for fft_len_ and shared by all frames. </summary>
+	RealFFT<eT> fft_;
 	
 	/// <summary>	The filter matrix. </summary>
-	arma::mat filter_mat_;
+	mat_type filter_mat_;
+
+	/// <summary>	First FFT bin of the sparse filter, bins before it feed no channel. </summary>
+	arma::uword filter_first_bin_;
+
+	/// <summary>	Lower channel of each bin of the sparse filter, the upper one is next to it. </summary>
+	arma::uvec filter_chan_;
+
+	/// <summary>	Weight of each bin of the sparse filter in its lower channel. </summary>
+	vec_type filter_lo_wt_;
+
+	/// <summary>	Weight of each bin of the sparse filter in its upper channel. </summary>
+	vec_type filter_hi_wt_;
 
 	/// <summary>	The hamming vector. </summary>
-	arma::vec hamm_;
+	vec_type hamm_;
 
 	/// <summary>	The dct base. </summary>
-	arma::mat dct_base_;
+	mat_type dct_base_;
 
 	/// <summary>	The lifter vector. </summary>
-	arma::vec lifter_;
+	vec_type lifter_;
 
 	/// <summary>	The mfnorm. </summary>
-	double mfnorm_;
+	eT mfnorm_;
+
+	/// <summary>	Number of features per frame. </summary>
+	int feat_num_;
+
+	/// <summary>	The threads of get_feats, null when num_threads is 1. </summary>
+	std::shared_ptr<ThreadPool> pool_;
 };
+
+/// <summary>	Double precision MFCC extractor. </summary>
+typedef MFCC_HTK_T<double> MFCC_HTK;
+
+/// <summary>	Single precision MFCC extractor. </summary>
+typedef MFCC_HTK_T<float> MFCC_HTK_F;
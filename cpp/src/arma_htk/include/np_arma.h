@@ -22,44 +22,50 @@ namespace arma
 	}
 
 	template<typename T>
-	static vec hstack(const std::vector<T>& v) {
-		vec feature = v[0];
+	static T hstack(const std::vector<T>& v) {
+		T feature = v[0];
 		for (auto i = 1u; i < v.size(); ++i) {
 			feature = hstack(feature, v[i]);
 		}
 		return feature;
 	}
 
-	static vec arange(int num)
+	template<typename vec_type = vec>
+	static vec_type arange(int num)
 	{
-		return linspace<vec>(0, num - 1, num);
+		return linspace<vec_type>(0, num - 1, num);
 	}
 
-	static vec arange(int start, int stop)
+	template<typename vec_type = vec>
+	static vec_type arange(int start, int stop)
 	{
-		return linspace<vec>(start, stop-1, stop - start);
+		return linspace<vec_type>(start, stop-1, stop - start);
 	}
 
-	static vec hamming(int M)
+	// computed in double precision for every vec_type
+	template<typename vec_type = vec>
+	static vec_type hamming(int M)
 	{
 		if (M < 1) {
 			return{};
 		}
-		if (M < 1) {
+		if (M == 1) {
 			return{ 1 };
 		}
 
 		auto n = arange(M);
-		return 0.54 - 0.46*cos(2.0*datum::pi*n / (M - 1));
+		vec w = 0.54 - 0.46*cos(2.0*datum::pi*n / (M - 1));
+		return conv_to<vec_type>::from(w);
 	}
 
-	static mat asarray(const std::vector<vec>& in) {
+	template<typename eT>
+	static Mat<eT> asarray(const std::vector<Col<eT>>& in) {
 		if (in.empty()) {
-			return mat();
+			return Mat<eT>();
 		}
 		const int cols = in.size();
 		const int rows = in[0].n_rows;
-		mat out(rows, cols);
+		Mat<eT> out(rows, cols);
 		for (auto i = 0u; i < in.size(); ++i) {
 			out.col(i) = in[i];
 		}
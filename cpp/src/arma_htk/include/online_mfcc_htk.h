@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	online_mfcc_htk.h
+//
+// summary:	Declares the OnlineMFCC_HTK class for computing features of a live audio stream
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+#include <armadillo>
+#include "mfcc_htk.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Computes MFCC_HTK features from audio that arrives in chunks. </summary>
+/// <details>
+/// Samples can be pushed in chunks of any size. Every push computes all frames whose window is
+/// complete, the samples of the next frame are kept in a ring buffer.
+///
+/// Deltas and accelerations are computed like MFCC_HTK::get_delta on the statics and on the
+/// deltas. Each order waits for deltawin frames of lookahead of the order below it, so frame t is
+/// returned once the statics of frame t + order * deltawin are known, or on flush().
+///
+/// The frames are computed one at a time, as with block_frames = 1 whatever the configuration
+/// says. They are identical to the output of MFCC_HTK::get_feats and get_delta run on the whole
+/// signal with the same configuration and block_frames = 1; batch and online extractors that
+/// must agree bit for bit have to share that setting, other block sizes round the matrix
+/// products of the filterbank and the DCT differently in the last bits. The utterance-level
+/// post-processing (cmn and enormalise) needs the whole utterance and is not supported.
+/// </details>
+///
+/// <typeparam name="eT">	Element type, double or float. </typeparam>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+class OnlineMFCC_HTK_T
+{
+public:
+
+	typedef MFCC_HTK_Config Config;
+	typedef arma::Col<eT> vec_type;
+	typedef arma::Mat<eT> mat_type;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Constructor. </summary>
+	///
+	/// <param name="config">  	The configuration. </param>
+	/// <param name="deltawin">	(Optional) the DELTAWINDOW (and ACCWINDOW) parameter. </param>
+	/// <param name="order">   	(Optional) number of difference orders appended to the statics:
+	/// 						0 for statics only, 1 for deltas, 2 for deltas and accelerations. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	OnlineMFCC_HTK_T(const Config& config, int deltawin = 2, int order = 2);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Appends samples to the stream. </summary>
+	///
+	/// <param name="samples">	The samples. </param>
+	/// <param name="n">	  	Number of samples. </param>
+	///
+	/// <returns>	The frames completed by these samples, one per column (one per row with 
+	/// 			FeatureLayout::feature_major), possibly none. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	mat_type push(const eT* samples, arma::uword n);
+
+	mat_type push(const vec_type& samples) { return push(samples.memptr(), samples.n_elem); }
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Ends the utterance and returns all remaining frames. </summary>
+	/// <details>	The extractor is reset afterwards and can be used for the next utterance. </details>
+	///
+	/// <returns>	The remaining frames, in the same layout as push. </returns>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	mat_type flush();
+
+	/// <summary>	Drops all buffered samples and frames and starts a new utterance. </summary>
+	void reset();
+
+	/// <summary>	Number of features per returned frame. </summary>
+	int feat_num() const { return mfcc_.feat_num() * (order_ + 1); }
+
+	/// <summary>	Lookahead of the deltas in frames. </summary>
+	int lookahead() const { return deltawin_ * order_; }
+
+	/// <summary>	Number of frames returned since the start of the utterance. </summary>
+	arma::uword frames_emitted() const { return emitted_; }
+
+private:
+
+	/// <summary>	Computes the next count frames of statics from the ring buffer. </summary>
+	void process_block(arma::uword count, std::vector<eT>& out);
+
+	/// <summary>	Computes the differences that have enough lookahead (all of them if final) and
+	/// 			appends the finished frames to out. </summary>
+	void cascade(bool final, std::vector<eT>& out);
+
+	/// <summary>	Converts the finished frames to a matrix in the configured layout. </summary>
+	mat_type gather(const std::vector<eT>& out) const;
+
+	/// <summary>	The extractor doing the frame-level work. </summary>
+	MFCC_HTK_T<eT> mfcc_;
+
+	/// <summary>	Scratch buffers of mfcc_. </summary>
+	typename MFCC_HTK_T<eT>::Workspace ws_;
+
+	/// <summary>	The delta window. </summary>
+	int deltawin_;
+
+	/// <summary>	Number of difference orders. </summary>
+	int order_;
+
+	/// <summary>	Ring buffer with the samples of the next frame. </summary>
+	vec_type ring_;
+
+	/// <summary>	Position of the oldest sample in the ring buffer. </summary>
+	arma::uword ring_head_;
+
+	/// <summary>	Number of samples in the ring buffer. </summary>
+	arma::uword ring_size_;
+
+	/// <summary>	Number of incoming samples to drop (only when win_shift > win_len). </summary>
+	arma::uword skip_;
+
+	/// <summary>	Ring of recent frames for every order, frame t is in column t % n_cols. </summary>
+	std::vector<mat_type> levels_;
+
+	/// <summary>	Number of frames computed for every order. </summary>
+	std::vector<arma::uword> done_;
+
+	/// <summary>	Number of frames returned. </summary>
+	arma::uword emitted_;
+};
+
+/// <summary>	Double precision online extractor. </summary>
+typedef OnlineMFCC_HTK_T<double> OnlineMFCC_HTK;
+
+/// <summary>	Single precision online extractor. </summary>
+typedef OnlineMFCC_HTK_T<float> OnlineMFCC_HTK_F;
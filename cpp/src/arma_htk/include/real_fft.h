@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	real_fft.h
+//
+// summary:	Declares the RealFFT class, a reusable FFT plan for real input signals
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <complex>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	FFT plan for real input of a fixed power-of-two length. </summary>
+/// <details>
+/// The bit-reversal permutation and the twiddle factors are computed once in the constructor.
+/// A real signal of length N is transformed as a complex signal of length N/2 (even samples
+/// in the real part, odd samples in the imaginary part) followed by a post-processing pass
+/// that separates the two interleaved spectra.
+///
+/// The plan is never modified after construction, so a single instance can be shared by any
+/// number of threads as long as each thread passes its own work buffer.
+///
+/// Instantiated for double and float. The twiddle factors are always computed in double
+/// precision and then rounded to the element type.
+/// </details>
+///
+/// <typeparam name="eT">	Element type, double or float. </typeparam>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+class RealFFT
+{
+public:
+
+	typedef std::complex<eT> cx_type;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Constructor. </summary>
+	///
+	/// <param name="n">	Length of the transform. Must be a power of two, at least 2. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	explicit RealFFT(int n = 2);
+
+	/// <summary>	Length of the transform. </summary>
+	int size() const { return n_; }
+
+	/// <summary>	Number of complex values needed in the work buffer (N/2 + 1). </summary>
+	int work_size() const { return n_ / 2 + 1; }
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the non-negative half of the spectrum of a real signal. </summary>
+	///
+	/// <param name="in"> 	The input samples. </param>
+	/// <param name="len">	Number of input samples. Shorter input is zero padded to N, longer
+	/// 					input is truncated. </param>
+	/// <param name="out">	Receives the N/2 + 1 spectral bins 0 ... N/2. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void forward(const eT* in, int len, cx_type* out) const;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Computes the magnitude of the first N/2 spectral bins of a real signal. </summary>
+	///
+	/// <param name="in">  	The input samples. </param>
+	/// <param name="len"> 	Number of input samples (zero padded to N). </param>
+	/// <param name="out"> 	Receives the magnitudes of bins 0 ... N/2 - 1. </param>
+	/// <param name="work">	Work buffer of at least work_size() elements. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void magnitude(const eT* in, int len, eT* out, cx_type* work) const;
+
+private:
+
+	/// <summary>	In-place complex FFT of length N/2 on the packed signal. </summary>
+	void complex_fft(cx_type* z) const;
+
+	/// <summary>	Length of the real transform. </summary>
+	int n_;
+
+	/// <summary>	Bit-reversal permutation of the half-length transform. </summary>
+	std::vector<int> bitrev_;
+
+	/// <summary>	Twiddle factors exp(-2 pi i k / (N/2)) of the half-length transform. </summary>
+	std::vector<cx_type> twiddle_;
+
+	/// <summary>	Post-processing twiddle factors exp(-2 pi i k / N). </summary>
+	std::vector<cx_type> post_;
+};
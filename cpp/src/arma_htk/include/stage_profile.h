@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	stage_profile.h
+//
+// summary:	Declares the instrumentation of MFCC_HTK and HTKFile, compiled in with ARMA_HTK_PROFILE
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The instrumented stages, the stages of get_feats in the order they run. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum class ProfileStage {
+
+	/// <summary>	Framing the signal and converting the samples to the working precision. </summary>
+	convert,
+
+	preemphasis,
+
+	/// <summary>	The Hamming window. </summary>
+	window,
+
+	/// <summary>	The magnitude spectrum. </summary>
+	fft,
+
+	filterbank,
+
+	/// <summary>	Flooring and taking the log of the filter outputs. </summary>
+	log,
+
+	dct,
+
+	/// <summary>	Liftering and replacing values that are not finite. </summary>
+	lifter,
+
+	/// <summary>	The raw, windowed or cepstral energy. </summary>
+	energy,
+
+	/// <summary>	Copying the chosen features to the output. </summary>
+	gather,
+
+	/// <summary>	The per-utterance normalisation: CMN and energy normalisation. </summary>
+	cmn,
+
+	/// <summary>	get_delta and append_deltas. </summary>
+	delta,
+
+	/// <summary>	Checking and decoding the samples of an HTK file in HTKFile_T::load. </summary>
+	htk_load,
+
+	/// <summary>	Encoding and writing an HTK file in HTKFile_T::save. </summary>
+	htk_save,
+
+	count
+};
+
+/// <summary>	Number of stages. </summary>
+const int profile_stage_count = static_cast<int>(ProfileStage::count);
+
+/// <summary>	The name of a stage, e.g. "fft". </summary>
+const char* profile_stage_name(ProfileStage stage);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The cumulative counters of a stage. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct StageCounters {
+
+	/// <summary>	Nanoseconds spent in the stage. </summary>
+	uint64_t ns = 0;
+
+	/// <summary>	Time stamp counter cycles spent in the stage, 0 on processors without one. </summary>
+	uint64_t cycles = 0;
+
+	/// <summary>	How often the stage ran, once per block of frames for the stages of get_feats. </summary>
+	uint64_t calls = 0;
+
+	/// <summary>	Frames (or HTK samples) processed by the stage. </summary>
+	uint64_t frames = 0;
+
+	/// <summary>	Allocations made in the stage, counted by the allocation counter. </summary>
+	uint64_t allocations = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The counters of all stages. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct StageProfile {
+
+	StageCounters stages[profile_stage_count];
+
+	/// <summary>	Bytes of HTK files read by HTKFile_T::load and load_range. </summary>
+	uint64_t bytes_read = 0;
+
+	/// <summary>
+	/// Buffers allocated by the extraction and by HTKFile_T::load: output matrices and the
+	/// workspace matrices that had to grow. Allocations inside Armadillo expressions are not seen.
+	/// </summary>
+	uint64_t allocations = 0;
+
+	const StageCounters& operator[](ProfileStage stage) const { return stages[static_cast<int>(stage)]; }
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	The counts between an earlier snapshot and this one. </summary>
+	/// <details>
+	/// A service exporting metrics periodically takes a snapshot every few seconds and reports the
+	/// difference to the previous one.
+	/// </details>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	StageProfile since(const StageProfile& earlier) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Whether the library was built with ARMA_HTK_PROFILE. </summary>
+/// <details>
+/// Without it the instrumentation compiles to nothing and stage_profile() always returns zeros,
+/// so the extraction pays nothing for it. With it every thread counts into its own accumulators
+/// without locks.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool stage_profile_enabled();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	A snapshot of the counters of all threads since the last reset. </summary>
+/// <details>
+/// The accumulators of the running threads are summed on demand, together with the counts of
+/// the threads that have exited. Can be called from any thread at any time, the counts of a
+/// stage that is running are added when it ends.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StageProfile stage_profile();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Sets the counters of all threads to zero. </summary>
+/// <details>
+/// Counts added while the reset runs may be lost. Call it when no extraction is running, or use
+/// StageProfile::since instead.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reset_stage_profile();
+
+/// <summary>	Returns the number of allocations made by the calling thread so far. </summary>
+typedef uint64_t (*AllocationCounter)();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Sets the counter charging allocations to the stages, nullptr to stop counting. </summary>
+/// <details>
+/// The library cannot see the allocations of the process, a program replacing operator new can
+/// count them per thread and pass that count here. The stages read it when they start and end,
+/// like the clock. Set it before the extraction runs.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void set_allocation_counter(AllocationCounter counter);
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	thread_pool.h
+//
+// summary:	Declares the ThreadPool class used to spread feature extraction over several cores
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	A fixed set of worker threads running parallel loops. </summary>
+/// <details>
+/// parallel_for hands out the loop indices one at a time to the workers and to the calling
+/// thread, which always takes part. parallel_for_stealing deals the indices to one queue per
+/// thread up front; a thread works through its own queue from the front and, once it is empty,
+/// steals from the back of the others. Several threads may run parallel loops on the same pool
+/// at the same time; the workers then serve the loops in the order they were started.
+///
+/// The loop body also receives a slot number in [0, size()) that no other thread uses during
+/// the same loop, so it can index per-thread scratch buffers.
+///
+/// Which thread runs which index is not deterministic. Code that needs a deterministic result
+/// must make each index independent and combine per-index results in index order.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool
+{
+public:
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Constructor. </summary>
+	///
+	/// <param name="threads">	(Optional) number of threads running a loop, including the calling
+	/// 						thread. 0 uses one thread per hardware thread. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	explicit ThreadPool(int threads = 0);
+
+	/// <summary>	Destructor. Waits for the workers to exit. </summary>
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// <summary>	Number of threads running a loop, including the calling thread. </summary>
+	int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+	/// <summary>	The loop body, called with the index and the slot of the running thread. </summary>
+	typedef std::function<void(std::size_t, int)> Body;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Runs fn(i, slot) for every i in [0, n) and waits for all of them to finish. </summary>
+	///
+	/// <param name="n"> 	Number of indices. </param>
+	/// <param name="fn">	The loop body. If it throws, the remaining indices are still run and
+	/// 					the first exception is rethrown in the calling thread. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void parallel_for(std::size_t n, const Body& fn);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Runs fn(i, slot) for every i in order, with work stealing. </summary>
+	/// <details>	
+	/// order is dealt round-robin to the queues of the threads, so every thread starts with the
+	/// first elements of order. Put the most expensive indices first to keep the tail short.
+	/// </details>
+	///
+	/// <param name="order">	The indices, in the order they should be started. </param>
+	/// <param name="fn">   	The loop body, see parallel_for. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void parallel_for_stealing(const std::vector<std::size_t>& order, const Body& fn);
+
+private:
+
+	/// <summary>	The queue of a thread in a work stealing loop. </summary>
+	struct StealQueue {
+		std::mutex mutex;
+		std::deque<std::size_t> items;
+	};
+
+	/// <summary>	A running parallel loop. </summary>
+	struct Job {
+		const Body* fn;
+		std::size_t n;
+		std::atomic<std::size_t> next;
+		std::vector<std::unique_ptr<StealQueue>>* queues;
+		std::atomic<int> slots;
+		std::atomic<std::size_t> done;
+		int active;
+		std::exception_ptr error;
+	};
+
+	/// <summary>	Starts the job, takes part in it and waits for it to finish. </summary>
+	void execute(Job& job);
+
+	/// <summary>	Claims the next index of the job for the given slot. </summary>
+	bool take(Job& job, int slot, std::size_t& index);
+
+	/// <summary>	Runs indices of the job until none are left. </summary>
+	void run(Job& job);
+
+	/// <summary>	The worker thread main loop. </summary>
+	void worker();
+
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable work_cv_;
+	std::condition_variable done_cv_;
+	std::deque<Job*> jobs_;
+	bool stop_;
+};
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	trace_events.h
+//
+// summary:	Declares the timeline tracing of the feature pipeline in the Chrome trace event format
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace trace_detail {
+
+	/// <summary>	Whether events are recorded, see start_trace. </summary>
+	extern std::atomic<bool> active;
+
+	/// <summary>	Nanoseconds of the steady clock. </summary>
+	uint64_t now();
+
+	/// <summary>	Appends a complete event to the buffer of the calling thread. </summary>
+	void record(const char* name, uint64_t begin, uint64_t end);
+}
+
+/// <summary>	Whether events are being recorded. One relaxed load. </summary>
+inline bool tracing()
+{
+	return trace_detail::active.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Starts recording trace events and drops the events of an earlier trace. </summary>
+/// <details>
+/// Every thread records into its own buffer of events_per_thread events, allocated on its
+/// first event. Recording takes two clock readings and one store to that buffer, no locks and
+/// no allocations. When a buffer is full its further events are dropped and counted. The
+/// overhead is low enough to trace every n-th run of a production service.
+/// </details>
+///
+/// <param name="events_per_thread">	(Optional) capacity of the buffer of each thread. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void start_trace(std::size_t events_per_thread = 1 << 16);
+
+/// <summary>	Stops recording. The events are kept until the next start_trace. </summary>
+void stop_trace();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Names the calling thread in the trace, e.g. "writer". </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void set_trace_thread_name(const std::string& name);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Writes the recorded events as Chrome trace event JSON. </summary>
+/// <details>
+/// The file can be opened in chrome://tracing or https://ui.perfetto.dev. Every event is a
+/// complete ("X") event on the thread that recorded it, with times in microseconds since
+/// start_trace. Events still being recorded by running threads may be missing, write the trace
+/// after stop_trace and after the traced work finished.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void write_trace(std::ostream& out);
+
+/// <summary>	Writes the trace to a file, see write_trace. Returns false if it cannot be written. </summary>
+bool write_trace(const std::string& filename);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Records its lifetime as an event if tracing is on when it is created. </summary>
+/// <details>
+/// The name is not copied, it must be a string literal or live as long as the trace.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class TraceScope
+{
+public:
+
+	explicit TraceScope(const char* name)
+		: name_(tracing() ? name : nullptr), begin_(name_ ? trace_detail::now() : 0) {}
+
+	~TraceScope()
+	{
+		if (name_) {
+			trace_detail::record(name_, begin_, trace_detail::now());
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+
+	const char* name_;
+	uint64_t begin_;
+};
@@ -0,0 +1,179 @@
+#include "batch_loader.h"
+#include <algorithm>
+#include <stdexcept>
+#include "htk_file.h"
+#include "htk_format.h"
+#include "htk_probe.h"
+#include "trace_events.h"
+
+namespace {
+
+	/// <summary>	Unmaps the files of a load when it returns or throws. </summary>
+	struct UnmapFiles {
+		std::vector<MappedFile>& files;
+
+		~UnmapFiles() { files.clear(); }
+	};
+}
+
+template<typename eT>
+BatchLoader_T<eT>::BatchLoader_T(int threads, HTKByteOrder order)
+	: order_(order), pool_(threads)
+{
+}
+
+template<typename eT>
+std::unique_ptr<typename BatchLoader_T<eT>::Batch> BatchLoader_T<eT>::acquire()
+{
+	std::lock_guard<std::mutex> lock(pool_mutex_);
+	if (free_.empty()) {
+		return std::unique_ptr<Batch>(new Batch());
+	}
+	std::unique_ptr<Batch> batch = std::move(free_.back());
+	free_.pop_back();
+	return batch;
+}
+
+template<typename eT>
+void BatchLoader_T<eT>::recycle(std::unique_ptr<Batch> batch)
+{
+	if (batch) {
+		std::lock_guard<std::mutex> lock(pool_mutex_);
+		free_.push_back(std::move(batch));
+	}
+}
+
+template<typename eT>
+std::size_t BatchLoader_T<eT>::pooled() const
+{
+	std::lock_guard<std::mutex> lock(pool_mutex_);
+	return free_.size();
+}
+
+template<typename eT>
+void BatchLoader_T<eT>::allocate(Batch& batch, const std::vector<arma::uword>& frames, arma::uword features)
+{
+	batch.features_ = features;
+	batch.offsets_.resize(frames.size() + 1);
+	batch.offsets_[0] = 0;
+	for (std::size_t i = 0; i < frames.size(); ++i) {
+		batch.offsets_[i + 1] = batch.offsets_[i] + frames[i];
+	}
+
+	const std::size_t values = static_cast<std::size_t>(batch.offsets_.back()) * features;
+	if (batch.buffer_.size() < values) {
+		batch.buffer_.resize(values);
+	}
+}
+
+template<typename eT>
+std::unique_ptr<typename BatchLoader_T<eT>::Batch> BatchLoader_T<eT>::load(const std::vector<std::string>& paths)
+{
+	std::lock_guard<std::mutex> lock(load_mutex_);
+	const std::size_t n = paths.size();
+	UnmapFiles unmap{ files_ };
+	files_.resize(n);
+	frames_.resize(n);
+	features_.resize(n);
+
+	// maps the files and reads the headers
+	pool_.parallel_for(n, [&](std::size_t i, int) {
+		TraceScope trace("read_header");
+		files_[i] = MappedFile(paths[i]);
+		HTKHeader header;
+		if (files_[i].size() < htk_header_size || !parse_htk_header(files_[i].data(), header, order_)) {
+			throw std::runtime_error("invalid header in " + paths[i]);
+		}
+		frames_[i] = static_cast<arma::uword>(header.samples);
+		features_[i] = header.features();
+	});
+
+	for (std::size_t i = 1; i < n; ++i) {
+		if (features_[i] != features_[0]) {
+			throw std::runtime_error("the number of features of " + paths[i] + " differs from " + paths[0]);
+		}
+	}
+
+	std::unique_ptr<Batch> batch = acquire();
+	allocate(*batch, frames_, n > 0 ? features_[0] : 0);
+
+	// decodes every file into its place in the buffer, the pages are read here
+	Batch& b = *batch;
+	pool_.parallel_for(n, [&](std::size_t i, int) {
+		TraceScope trace("read_file");
+		HTKFile_T<eT> file(FeatureLayout::frame_major, order_);
+		try {
+			file.load_memory(files_[i].data(), files_[i].size(), b.buffer_.data() + b.offsets_[i] * b.features_);
+		}
+		catch (const std::runtime_error& e) {
+			throw std::runtime_error(e.what() + (" in " + paths[i]));
+		}
+		files_[i] = MappedFile();
+	});
+
+	return batch;
+}
+
+template<typename eT>
+std::unique_ptr<typename BatchLoader_T<eT>::Batch> BatchLoader_T<eT>::load(const ArchiveReader& archive,
+	const std::vector<std::string>& keys)
+{
+	std::lock_guard<std::mutex> lock(load_mutex_);
+	const std::size_t n = keys.size();
+
+	// the index has everything needed to lay out the batch
+	std::vector<ArchiveReader::Entry> entries(n);
+	frames_.resize(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		const std::size_t at = archive.find(keys[i]);
+		if (at == archive.size()) {
+			throw std::runtime_error("the key " + keys[i] + " is not in the archive");
+		}
+		entries[i] = archive.entry(at);
+		frames_[i] = entries[i].frames;
+		if (entries[i].dims != entries[0].dims) {
+			throw std::runtime_error("the number of features of " + keys[i] + " differs from " + keys[0]);
+		}
+	}
+
+	std::unique_ptr<Batch> batch = acquire();
+	allocate(*batch, frames_, n > 0 ? entries[0].dims : 0);
+
+	Batch& b = *batch;
+	pool_.parallel_for(n, [&](std::size_t i, int) {
+		TraceScope trace("read_entry");
+		const ArchiveReader::Entry& e = entries[i];
+		const char* src = archive.bytes(e);
+		eT* dst = b.buffer_.data() + b.offsets_[i] * b.features_;
+		if (e.encoding == ArchiveEncoding::native_float) {
+			const std::size_t values = static_cast<std::size_t>(e.frames) * e.dims;
+			if (e.bytes != values * sizeof(float)) {
+				throw std::runtime_error("damaged matrix of " + keys[i]);
+			}
+			const float* f = reinterpret_cast<const float*>(src);
+			std::copy(f, f + values, dst);
+		}
+		else {
+			// the header must agree with the index, which sized the buffer
+			HTKHeader header;
+			if (e.bytes < htk_header_size || !parse_htk_header(src, header) ||
+				static_cast<uint32_t>(header.samples) != e.frames || static_cast<uint32_t>(header.features()) != e.dims) {
+				throw std::runtime_error("damaged matrix of " + keys[i]);
+			}
+			HTKFile_T<eT> file(FeatureLayout::frame_major);
+			try {
+				file.load_memory(src, static_cast<std::size_t>(e.bytes), dst);
+			}
+			catch (const std::runtime_error& err) {
+				throw std::runtime_error(err.what() + (" in " + keys[i]));
+			}
+		}
+	});
+
+	return batch;
+}
+
+template class FeatureBatch_T<double>;
+template class FeatureBatch_T<float>;
+template class BatchLoader_T<double>;
+template class BatchLoader_T<float>;
@@ -0,0 +1,375 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	byteswap.h
+//
+// summary:	Helpers decoding and encoding big-endian arrays, as stored in HTK files. The bulk
+// 			kernels take a swap flag, false for files in the natural order of the machine
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HTK_BYTESWAP_SSE2
+#endif
+
+inline uint32_t bswap32(uint32_t val)
+{
+#ifdef _MSC_VER
+	return _byteswap_ulong(val);
+#else
+	return __builtin_bswap32(val);
+#endif
+}
+
+inline uint16_t bswap16(uint16_t val)
+{
+#ifdef _MSC_VER
+	return _byteswap_ushort(val);
+#else
+	return __builtin_bswap16(val);
+#endif
+}
+
+/// <summary>	Reads a big-endian 32-bit value from unaligned memory. </summary>
+inline uint32_t read_be32(const char* src)
+{
+	uint32_t val;
+	std::memcpy(&val, src, sizeof(val));
+	return bswap32(val);
+}
+
+/// <summary>	Reads a big-endian 16-bit value from unaligned memory. </summary>
+inline uint16_t read_be16(const char* src)
+{
+	uint16_t val;
+	std::memcpy(&val, src, sizeof(val));
+	return bswap16(val);
+}
+
+/// <summary>	Writes a big-endian 32-bit value to unaligned memory. </summary>
+inline void write_be32(uint32_t val, char* dst)
+{
+	val = bswap32(val);
+	std::memcpy(dst, &val, sizeof(val));
+}
+
+/// <summary>	Writes a big-endian 16-bit value to unaligned memory. </summary>
+inline void write_be16(uint16_t val, char* dst)
+{
+	val = bswap16(val);
+	std::memcpy(dst, &val, sizeof(val));
+}
+
+/// <summary>	Reads a 32-bit value from unaligned memory, swapping the bytes if swap is set. </summary>
+inline uint32_t read32(const char* src, bool swap)
+{
+	uint32_t val;
+	std::memcpy(&val, src, sizeof(val));
+	return swap ? bswap32(val) : val;
+}
+
+/// <summary>	Reads a 16-bit value from unaligned memory, swapping the bytes if swap is set. </summary>
+inline uint16_t read16(const char* src, bool swap)
+{
+	uint16_t val;
+	std::memcpy(&val, src, sizeof(val));
+	return swap ? bswap16(val) : val;
+}
+
+/// <summary>	Writes a 32-bit value to unaligned memory, swapping the bytes if swap is set. </summary>
+inline void write32(uint32_t val, char* dst, bool swap)
+{
+	val = swap ? bswap32(val) : val;
+	std::memcpy(dst, &val, sizeof(val));
+}
+
+/// <summary>	Writes a 16-bit value to unaligned memory, swapping the bytes if swap is set. </summary>
+inline void write16(uint16_t val, char* dst, bool swap)
+{
+	val = swap ? bswap16(val) : val;
+	std::memcpy(dst, &val, sizeof(val));
+}
+
+/// <summary>	Writes a big-endian float to unaligned memory. </summary>
+inline void write_be_float(float f, char* dst)
+{
+	uint32_t val;
+	std::memcpy(&val, &f, sizeof(val));
+	write_be32(val, dst);
+}
+
+/// <summary>	Reads a big-endian float from unaligned memory. </summary>
+inline float read_be_float(const char* src)
+{
+	uint32_t val = read_be32(src);
+	float f;
+	std::memcpy(&f, &val, sizeof(f));
+	return f;
+}
+
+#ifdef HTK_BYTESWAP_SSE2
+/// <summary>	Swaps the bytes of every 16-bit lane. </summary>
+inline __m128i bswap16_sse2(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+/// <summary>	Swaps the bytes of every 32-bit lane. </summary>
+inline __m128i bswap32_sse2(__m128i v)
+{
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	return bswap16_sse2(v);
+}
+
+inline __m128 load_ps(const float* src)
+{
+	return _mm_loadu_ps(src);
+}
+
+inline __m128 load_ps(const double* src)
+{
+	return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(src)), _mm_cvtpd_ps(_mm_loadu_pd(src + 2)));
+}
+
+inline void store_ps(float* dst, __m128 v)
+{
+	_mm_storeu_ps(dst, v);
+}
+
+inline void store_ps(double* dst, __m128 v)
+{
+	_mm_storeu_pd(dst, _mm_cvtps_pd(v));
+	_mm_storeu_pd(dst + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Decodes n big-endian floats to T (float or double). </summary>
+///
+/// <param name="src"> 	The big-endian data, no alignment needed. </param>
+/// <param name="n">   	Number of values. </param>
+/// <param name="dst"> 	Receives the n values. </param>
+/// <param name="swap">	(Optional) false if the data is in the byte order of the machine. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+inline void decode_be_floats(const char* src, std::size_t n, T* dst, bool swap = true)
+{
+	std::size_t i = 0;
+#ifdef HTK_BYTESWAP_SSE2
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+		store_ps(dst + i, _mm_castsi128_ps(swap ? bswap32_sse2(v) : v));
+	}
+#endif
+	for (; i < n; ++i) {
+		uint32_t val = read32(src + 4 * i, swap);
+		float f;
+		std::memcpy(&f, &val, sizeof(f));
+		dst[i] = f;
+	}
+}
+
+/// <summary>	Floats in the byte order of the machine need no conversion. </summary>
+inline void decode_be_floats(const char* src, std::size_t n, float* dst, bool swap = true)
+{
+	if (!swap) {
+		std::memcpy(dst, src, 4 * n);
+		return;
+	}
+	decode_be_floats<float>(src, n, dst, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Decodes n big-endian 16-bit signed integers. </summary>
+///
+/// <param name="src">	The big-endian data, no alignment needed. </param>
+/// <param name="n">  	Number of values. </param>
+/// <param name="dst">	Receives the n values. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void decode_be_shorts(const char* src, std::size_t n, int16_t* dst)
+{
+	std::size_t i = 0;
+#ifdef HTK_BYTESWAP_SSE2
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bswap16_sse2(v));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = static_cast<int16_t>(read_be16(src + 2 * i));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Encodes n values of type T (float or double) as big-endian floats. </summary>
+///
+/// <param name="src">	The values. </param>
+/// <param name="n">  	Number of values. </param>
+/// <param name="dst"> 	Receives 4 * n bytes, no alignment needed. </param>
+/// <param name="swap">	(Optional) false to write in the byte order of the machine. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+inline void encode_be_floats(const T* src, std::size_t n, char* dst, bool swap = true)
+{
+	std::size_t i = 0;
+#ifdef HTK_BYTESWAP_SSE2
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_castps_si128(load_ps(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), swap ? bswap32_sse2(v) : v);
+	}
+#endif
+	for (; i < n; ++i) {
+		const float f = static_cast<float>(src[i]);
+		uint32_t val;
+		std::memcpy(&val, &f, sizeof(val));
+		write32(val, dst + 4 * i, swap);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Encodes n 16-bit signed integers as big-endian. </summary>
+///
+/// <param name="src">	The values. </param>
+/// <param name="n">  	Number of values. </param>
+/// <param name="dst"> 	Receives 2 * n bytes, no alignment needed. </param>
+/// <param name="swap">	(Optional) false to write in the byte order of the machine. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void encode_be_shorts(const int16_t* src, std::size_t n, char* dst, bool swap = true)
+{
+	if (!swap) {
+		std::memcpy(dst, src, 2 * n);
+		return;
+	}
+
+	std::size_t i = 0;
+#ifdef HTK_BYTESWAP_SSE2
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), bswap16_sse2(v));
+	}
+#endif
+	for (; i < n; ++i) {
+		write_be16(static_cast<uint16_t>(src[i]), dst + 2 * i);
+	}
+}
+
+#ifdef HTK_BYTESWAP_SSE2
+/// <summary>	Sign extends the 8 lanes of v to 32 bits, lanes 0-3 in lo and 4-7 in hi. </summary>
+inline void widen_epi16(__m128i v, __m128i& lo, __m128i& hi)
+{
+	lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+	hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+/// <summary>	dst[0..3] = x * scale + offset for the 4 lanes of x. </summary>
+inline void affine4(__m128i x, const float* scale, const float* offset, float* dst)
+{
+	__m128 y = _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_loadu_ps(scale));
+	_mm_storeu_ps(dst, _mm_add_ps(y, _mm_loadu_ps(offset)));
+}
+
+inline void affine4(__m128i x, const double* scale, const double* offset, double* dst)
+{
+	__m128d y0 = _mm_mul_pd(_mm_cvtepi32_pd(x), _mm_loadu_pd(scale));
+	__m128d y1 = _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(x, 8)), _mm_loadu_pd(scale + 2));
+	_mm_storeu_pd(dst, _mm_add_pd(y0, _mm_loadu_pd(offset)));
+	_mm_storeu_pd(dst + 2, _mm_add_pd(y1, _mm_loadu_pd(offset + 2)));
+}
+
+/// <summary>	dst[0..3] = x / divisor for the 4 lanes of x, divided in double precision. </summary>
+inline void divide4(__m128i x, __m128d divisor, float* dst)
+{
+	__m128 lo = _mm_cvtpd_ps(_mm_div_pd(_mm_cvtepi32_pd(x), divisor));
+	__m128 hi = _mm_cvtpd_ps(_mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(x, 8)), divisor));
+	_mm_storeu_ps(dst, _mm_movelh_ps(lo, hi));
+}
+
+inline void divide4(__m128i x, __m128d divisor, double* dst)
+{
+	_mm_storeu_pd(dst, _mm_div_pd(_mm_cvtepi32_pd(x), divisor));
+	_mm_storeu_pd(dst + 2, _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(x, 8)), divisor));
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Decodes n big-endian 16-bit integers c to c * scale + offset. </summary>
+/// <details>	
+/// Decodes compressed HTK samples with scale = 1 / A and offset = B / A. Each group of 8 integers
+/// is loaded, byte swapped, widened and converted in SSE2 registers.
+/// </details>
+///
+/// <param name="src">   	The big-endian data, no alignment needed. </param>
+/// <param name="n">	 	Number of values. </param>
+/// <param name="scale"> 	The n scales. </param>
+/// <param name="offset">	The n offsets. </param>
+/// <param name="dst">   	Receives the n values. </param>
+/// <param name="swap">  	(Optional) false if the data is in the byte order of the machine. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+inline void decode_be_shorts_affine(const char* src, std::size_t n, const T* scale, const T* offset, T* dst,
+	bool swap = true)
+{
+	std::size_t i = 0;
+#ifdef HTK_BYTESWAP_SSE2
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+		if (swap) {
+			v = bswap16_sse2(v);
+		}
+		__m128i lo, hi;
+		widen_epi16(v, lo, hi);
+		affine4(lo, scale + i, offset + i, dst + i);
+		affine4(hi, scale + i + 4, offset + i + 4, dst + i + 4);
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = static_cast<int16_t>(read16(src + 2 * i, swap)) * scale[i] + offset[i];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Decodes n big-endian 16-bit integers c to c / divisor. </summary>
+/// <details>	
+/// Decodes WAVEFORM and IREFC samples with divisor = 32767. The division is done in double
+/// precision, so the values are exactly those of a scalar c / 32767.0, which a multiplication by
+/// 1 / 32767 is not.
+/// </details>
+///
+/// <param name="src">    	The big-endian data, no alignment needed. </param>
+/// <param name="n">	  	Number of values. </param>
+/// <param name="divisor">	The divisor. </param>
+/// <param name="dst">    	Receives the n values. </param>
+/// <param name="swap">   	(Optional) false if the data is in the byte order of the machine. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+inline void decode_be_shorts_divided(const char* src, std::size_t n, double divisor, T* dst, bool swap = true)
+{
+	std::size_t i = 0;
+#ifdef HTK_BYTESWAP_SSE2
+	const __m128d d = _mm_set1_pd(divisor);
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+		if (swap) {
+			v = bswap16_sse2(v);
+		}
+		__m128i lo, hi;
+		widen_epi16(v, lo, hi);
+		divide4(lo, d, dst + i);
+		divide4(hi, d, dst + i + 4);
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = static_cast<T>(static_cast<int16_t>(read16(src + 2 * i, swap)) / divisor);
+	}
+}
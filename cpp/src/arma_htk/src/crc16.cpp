@@ -0,0 +1,52 @@
+#include "crc16.h"
+
+namespace {
+
+	/// <summary>	
+	/// t[0][b] is the CRC of the byte b, t[k][b] the CRC of b followed by k zero bytes, so eight
+	/// bytes are folded in with eight independent lookups.
+	/// </summary>
+	struct Crc16Tables {
+		uint16_t t[8][256];
+
+		Crc16Tables() {
+			for (int b = 0; b < 256; ++b) {
+				uint16_t crc = static_cast<uint16_t>(b << 8);
+				for (int k = 0; k < 8; ++k) {
+					crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+				}
+				t[0][b] = crc;
+			}
+			for (int k = 1; k < 8; ++k) {
+				for (int b = 0; b < 256; ++b) {
+					uint16_t crc = t[k - 1][b];
+					t[k][b] = static_cast<uint16_t>((crc << 8) ^ t[0][crc >> 8]);
+				}
+			}
+		}
+	};
+
+	/// <summary>	Built on first use, so a CRC computed during static initialization sees the tables. </summary>
+	const Crc16Tables& tables()
+	{
+		static const Crc16Tables t;
+		return t;
+	}
+}
+
+uint16_t crc16_update(uint16_t crc, const char* data, std::size_t n)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+	const auto& t = tables().t;
+
+	// slicing by 8: the CRC only depends on the first two bytes of each group
+	for (; n >= 8; n -= 8, p += 8) {
+		crc = static_cast<uint16_t>(
+			t[7][p[0] ^ (crc >> 8)] ^ t[6][p[1] ^ (crc & 0xFF)] ^
+			t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]]);
+	}
+	for (; n > 0; --n, ++p) {
+		crc = static_cast<uint16_t>((crc << 8) ^ t[0][(crc >> 8) ^ *p]);
+	}
+	return crc;
+}
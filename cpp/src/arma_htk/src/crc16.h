@@ -0,0 +1,26 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	crc16.h
+//
+// summary:	Declares the CRC of HTK files with the K qualifier
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Continues a CRC-16/CCITT (polynomial 0x1021, initial value 0, no reflection). </summary>
+/// <details>	
+/// HTK appends this CRC of the payload (everything after the 12-byte header) to files with the 
+/// K qualifier, most significant byte first.
+/// </details>
+///
+/// <param name="crc"> 	The CRC of the data before, 0 to start. </param>
+/// <param name="data">	The next bytes. </param>
+/// <param name="n">   	Number of bytes. </param>
+///
+/// <returns>	The CRC including the n bytes. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t crc16_update(uint16_t crc, const char* data, std::size_t n);
@@ -0,0 +1,401 @@
+#include "feature_archive.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "htk_file.h"
+#include "htk_format.h"
+
+namespace {
+
+	/// <summary>	Alignment of the matrices in a shard. </summary>
+	const uint64_t entry_alignment = 64;
+
+	/// <summary>	Marks the file as an archive index. </summary>
+	const char index_magic[8] = { 'H', 'T', 'K', 'A', 'R', 'I', 'D', 'X' };
+
+	/// <summary>	Version of the index format. </summary>
+	const uint32_t index_version = 1;
+
+	/// <summary>	Written in native order, reads differently on a machine with another byte order. </summary>
+	const uint32_t byte_order_mark = 0x01020304;
+
+	/// <summary>	The header of the index, followed by the records and the key strings. </summary>
+	struct IndexHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint32_t shards;
+		uint32_t reserved;
+		uint64_t count;
+	};
+
+	/// <summary>	A record of the index, the records are sorted by key. </summary>
+	struct IndexRecord {
+		uint64_t key_offset;
+		uint64_t offset;
+		uint64_t bytes;
+		uint32_t key_length;
+		uint32_t shard;
+		uint32_t frames;
+		uint32_t dims;
+		int32_t samp_period;
+		uint16_t param_kind;
+		uint16_t encoding;
+	};
+
+	static_assert(sizeof(IndexHeader) == 32, "unexpected padding in IndexHeader");
+	static_assert(sizeof(IndexRecord) == 48, "unexpected padding in IndexRecord");
+
+	std::string shard_name(const std::string& prefix, uint32_t shard)
+	{
+		char number[24];
+		std::snprintf(number, sizeof(number), ".%05u.shard", shard);
+		return prefix + number;
+	}
+
+	/// <summary>	Compares a key in the index with a string like std::string::compare. </summary>
+	int compare_key(const char* key, std::size_t length, const std::string& other)
+	{
+		const int c = std::memcmp(key, other.data(), std::min(length, other.size()));
+		if (c != 0) {
+			return c;
+		}
+		return length < other.size() ? -1 : (length > other.size() ? 1 : 0);
+	}
+}
+
+ArchiveWriter::ArchiveWriter(const std::string& prefix, ArchiveEncoding encoding, FeatureLayout layout,
+	uint64_t shard_size)
+	: prefix_(prefix), encoding_(encoding), layout_(layout), shard_size_(shard_size), shard_index_(0),
+	shard_pos_(0), entry_start_(0), open_(false)
+{
+	open_shard(0);
+	open_ = true;
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+	try {
+		close();
+	}
+	catch (...) {
+	}
+}
+
+void ArchiveWriter::open_shard(uint32_t shard)
+{
+	shard_.close();
+	const std::string name = shard_name(prefix_, shard);
+	shard_.open(name, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!shard_) {
+		throw std::runtime_error("cannot create " + name);
+	}
+	shard_index_ = shard;
+	shard_pos_ = 0;
+}
+
+void ArchiveWriter::next_entry()
+{
+	if (!open_) {
+		throw std::runtime_error("the archive " + prefix_ + " is closed");
+	}
+
+	if (shard_pos_ >= shard_size_) {
+		if (!shard_.flush()) {
+			throw std::runtime_error("cannot write " + shard_name(prefix_, shard_index_));
+		}
+		open_shard(shard_index_ + 1);
+	}
+
+	const uint64_t pad = (entry_alignment - shard_pos_ % entry_alignment) % entry_alignment;
+	if (pad != 0) {
+		static const char zeros[entry_alignment] = {};
+		shard_.write(zeros, static_cast<std::streamsize>(pad));
+		shard_pos_ += pad;
+	}
+	entry_start_ = shard_pos_;
+}
+
+void ArchiveWriter::finish_entry(const std::string& key, uint32_t frames, uint32_t dims, int32_t samp_period,
+	uint16_t param_kind)
+{
+	if (!shard_) {
+		throw std::runtime_error("cannot write " + shard_name(prefix_, shard_index_));
+	}
+
+	Entry e;
+	e.shard = shard_index_;
+	e.offset = entry_start_;
+	e.bytes = shard_pos_ - entry_start_;
+	e.frames = frames;
+	e.dims = dims;
+	e.samp_period = samp_period;
+	e.param_kind = param_kind;
+	keys_.push_back(key);
+	entries_.push_back(e);
+}
+
+template<typename eT>
+void ArchiveWriter::add_htk(const std::string& key, const arma::Mat<eT>& data, int32_t samp_period,
+	const std::string& basic_kind, const std::set<std::string>& qualifiers)
+{
+	const uint16_t kind = encode_param_kind(basic_kind, qualifiers);
+	const bool frame_major = layout_ == FeatureLayout::frame_major;
+	const arma::uword frames = frame_major ? data.n_cols : data.n_rows;
+	const arma::uword dims = frame_major ? data.n_rows : data.n_cols;
+
+	HTKFile_T<eT> file(layout_);
+	file.set_data(data, samp_period, basic_kind, qualifiers);
+
+	next_entry();
+	const std::streamoff start = shard_.tellp();
+	file.save(shard_);
+	shard_pos_ += static_cast<uint64_t>(shard_.tellp() - start);
+	finish_entry(key, static_cast<uint32_t>(frames), static_cast<uint32_t>(dims), samp_period, kind);
+}
+
+void ArchiveWriter::add(const std::string& key, const arma::mat& data, int32_t samp_period,
+	const std::string& basic_kind, const std::set<std::string>& qualifiers)
+{
+	if (encoding_ == ArchiveEncoding::native_float) {
+		add(key, arma::conv_to<arma::fmat>::from(data), samp_period, basic_kind, qualifiers);
+	}
+	else {
+		add_htk(key, data, samp_period, basic_kind, qualifiers);
+	}
+}
+
+void ArchiveWriter::add(const std::string& key, const arma::fmat& data, int32_t samp_period,
+	const std::string& basic_kind, const std::set<std::string>& qualifiers)
+{
+	if (encoding_ == ArchiveEncoding::htk) {
+		add_htk(key, data, samp_period, basic_kind, qualifiers);
+		return;
+	}
+
+	const uint16_t kind = encode_param_kind(basic_kind, qualifiers);
+	const bool frame_major = layout_ == FeatureLayout::frame_major;
+	const arma::uword frames = frame_major ? data.n_cols : data.n_rows;
+	const arma::uword dims = frame_major ? data.n_rows : data.n_cols;
+
+	// the shard always holds one frame after the other
+	const float* src = data.memptr();
+	if (!frame_major) {
+		staging_.resize(data.n_elem);
+		for (arma::uword t = 0; t < frames; ++t) {
+			for (arma::uword d = 0; d < dims; ++d) {
+				staging_[t * dims + d] = data(t, d);
+			}
+		}
+		src = staging_.data();
+	}
+
+	next_entry();
+	const uint64_t bytes = static_cast<uint64_t>(data.n_elem) * sizeof(float);
+	shard_.write(reinterpret_cast<const char*>(src), static_cast<std::streamsize>(bytes));
+	shard_pos_ += bytes;
+	finish_entry(key, static_cast<uint32_t>(frames), static_cast<uint32_t>(dims), samp_period, kind);
+}
+
+void ArchiveWriter::close()
+{
+	if (!open_) {
+		return;
+	}
+	open_ = false;
+
+	shard_.close();
+	if (shard_.fail()) {
+		throw std::runtime_error("cannot write " + shard_name(prefix_, shard_index_));
+	}
+
+	std::vector<std::size_t> order(keys_.size());
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+		return keys_[a] < keys_[b];
+	});
+	for (std::size_t i = 1; i < order.size(); ++i) {
+		if (keys_[order[i]] == keys_[order[i - 1]]) {
+			throw std::runtime_error("the key " + keys_[order[i]] + " was added twice to " + prefix_);
+		}
+	}
+
+	IndexHeader header;
+	std::memcpy(header.magic, index_magic, sizeof(header.magic));
+	header.version = index_version;
+	header.byte_order = byte_order_mark;
+	header.shards = shard_index_ + 1;
+	header.reserved = 0;
+	header.count = keys_.size();
+
+	std::vector<IndexRecord> records(order.size());
+	uint64_t key_offset = 0;
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		const Entry& e = entries_[order[i]];
+		IndexRecord& r = records[i];
+		r.key_offset = key_offset;
+		r.key_length = static_cast<uint32_t>(keys_[order[i]].size());
+		r.shard = e.shard;
+		r.offset = e.offset;
+		r.bytes = e.bytes;
+		r.frames = e.frames;
+		r.dims = e.dims;
+		r.samp_period = e.samp_period;
+		r.param_kind = e.param_kind;
+		r.encoding = static_cast<uint16_t>(encoding_);
+		key_offset += r.key_length;
+	}
+
+	const std::string name = prefix_ + ".index";
+	std::ofstream f(name, std::ios::out | std::ios::binary | std::ios::trunc);
+	f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	f.write(reinterpret_cast<const char*>(records.data()),
+		static_cast<std::streamsize>(records.size() * sizeof(IndexRecord)));
+	for (std::size_t i : order) {
+		f.write(keys_[i].data(), static_cast<std::streamsize>(keys_[i].size()));
+	}
+	f.close();
+	if (f.fail()) {
+		throw std::runtime_error("cannot write " + name);
+	}
+}
+
+ArchiveReader::ArchiveReader(const std::string& prefix, FeatureLayout layout)
+	: prefix_(prefix), layout_(layout), index_(prefix + ".index"), count_(0)
+{
+	const std::string name = prefix + ".index";
+	if (index_.size() < sizeof(IndexHeader)) {
+		throw std::runtime_error("unexpected end of file " + name);
+	}
+
+	IndexHeader header;
+	std::memcpy(&header, index_.data(), sizeof(header));
+	if (std::memcmp(header.magic, index_magic, sizeof(header.magic)) != 0) {
+		throw std::runtime_error(name + " is not an archive index");
+	}
+	if (header.byte_order != byte_order_mark) {
+		throw std::runtime_error(name + " was written on a machine with another byte order");
+	}
+	if (header.version != index_version) {
+		throw std::runtime_error("unsupported version of " + name);
+	}
+
+	const uint64_t records_size = header.count * sizeof(IndexRecord);
+	if (header.count > index_.size() / sizeof(IndexRecord) || index_.size() - sizeof(header) < records_size) {
+		throw std::runtime_error("unexpected end of file " + name);
+	}
+	count_ = static_cast<std::size_t>(header.count);
+	records_ = index_.data() + sizeof(header);
+	strings_ = records_ + records_size;
+	strings_size_ = index_.size() - sizeof(header) - records_size;
+
+	shards_.reserve(header.shards);
+	for (uint32_t s = 0; s < header.shards; ++s) {
+		shards_.emplace_back(shard_name(prefix, s));
+	}
+
+	for (std::size_t i = 0; i < count_; ++i) {
+		const IndexRecord& r = reinterpret_cast<const IndexRecord*>(records_)[i];
+		if (r.key_offset > strings_size_ || r.key_length > strings_size_ - r.key_offset ||
+			r.shard >= shards_.size() || r.offset > shards_[r.shard].size() ||
+			r.bytes > shards_[r.shard].size() - r.offset) {
+			throw std::runtime_error("damaged record " + std::to_string(i) + " in " + name);
+		}
+	}
+}
+
+std::string ArchiveReader::key(std::size_t i) const
+{
+	const IndexRecord& r = reinterpret_cast<const IndexRecord*>(records_)[i];
+	return std::string(strings_ + r.key_offset, r.key_length);
+}
+
+ArchiveReader::Entry ArchiveReader::entry(std::size_t i) const
+{
+	const IndexRecord& r = reinterpret_cast<const IndexRecord*>(records_)[i];
+	Entry e;
+	e.shard = r.shard;
+	e.offset = r.offset;
+	e.bytes = r.bytes;
+	e.frames = r.frames;
+	e.dims = r.dims;
+	e.samp_period = r.samp_period;
+	e.param_kind = r.param_kind;
+	e.encoding = static_cast<ArchiveEncoding>(r.encoding);
+	return e;
+}
+
+std::size_t ArchiveReader::find(const std::string& key) const
+{
+	const IndexRecord* records = reinterpret_cast<const IndexRecord*>(records_);
+	std::size_t lo = 0;
+	std::size_t hi = count_;
+	while (lo < hi) {
+		const std::size_t mid = lo + (hi - lo) / 2;
+		const int c = compare_key(strings_ + records[mid].key_offset, records[mid].key_length, key);
+		if (c == 0) {
+			return mid;
+		}
+		if (c < 0) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return count_;
+}
+
+ArchiveReader::Entry ArchiveReader::at(const std::string& key) const
+{
+	const std::size_t i = find(key);
+	if (i == count_) {
+		throw std::runtime_error("the key " + key + " is not in " + prefix_);
+	}
+	return entry(i);
+}
+
+ArchiveReader::View ArchiveReader::view(const std::string& key) const
+{
+	const Entry e = at(key);
+	if (e.encoding != ArchiveEncoding::native_float) {
+		throw std::runtime_error("the matrix of " + key + " is not stored as native floats");
+	}
+	if (e.bytes != static_cast<uint64_t>(e.frames) * e.dims * sizeof(float)) {
+		throw std::runtime_error("damaged matrix of " + key + " in " + prefix_);
+	}
+	if (e.bytes == 0) {
+		return View{ nullptr, e.dims, e.frames };
+	}
+	return View{ reinterpret_cast<const float*>(shards_[e.shard].data() + e.offset), e.dims, e.frames };
+}
+
+arma::mat ArchiveReader::load(const std::string& key) const
+{
+	const Entry e = at(key);
+	if (e.encoding == ArchiveEncoding::htk) {
+		HTKFile file(layout_);
+		try {
+			file.load_memory(shards_[e.shard].data() + e.offset, static_cast<std::size_t>(e.bytes));
+		}
+		catch (const std::runtime_error& err) {
+			throw std::runtime_error(std::string(err.what()) + " in " + key);
+		}
+		return file.data();
+	}
+
+	// converted straight from the mapping, the alias is only read
+	const View v = view(key);
+	arma::mat data(v.n_rows, v.n_cols);
+	if (v.mem) {
+		const arma::fmat floats(const_cast<float*>(v.mem), v.n_rows, v.n_cols, false, true);
+		data = arma::conv_to<arma::mat>::from(floats);
+	}
+	if (layout_ == FeatureLayout::feature_major) {
+		arma::inplace_trans(data);
+	}
+	return data;
+}
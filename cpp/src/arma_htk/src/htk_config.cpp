@@ -0,0 +1,225 @@
+#include "htk_config.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+	std::string trim(const std::string& s)
+	{
+		const auto first = s.find_first_not_of(" \t\r\n");
+		if (first == std::string::npos) {
+			return std::string();
+		}
+		const auto last = s.find_last_not_of(" \t\r\n");
+		return s.substr(first, last - first + 1);
+	}
+
+	std::string upper(std::string s)
+	{
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+		return s;
+	}
+
+	/// <summary>	Converts a duration in 100 ns units to a number of samples. </summary>
+	int samples(double duration, double source_rate)
+	{
+		return static_cast<int>(std::lround(duration / source_rate));
+	}
+}
+
+void HTKConfig::load(const std::string& filename)
+{
+	std::ifstream f(filename);
+	if (!f) {
+		throw std::runtime_error("cannot open " + filename);
+	}
+	parse(f, filename);
+}
+
+void HTKConfig::parse(std::istream& in, const std::string& name)
+{
+	std::string line;
+	int number = 0;
+	while (std::getline(in, line)) {
+		++number;
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty()) {
+			continue;
+		}
+
+		const auto eq = line.find('=');
+		if (eq == std::string::npos) {
+			throw std::runtime_error("missing = in line " + std::to_string(number) + " of " + name);
+		}
+
+		// the module name before a colon only restricts the parameter to one module
+		std::string key = trim(line.substr(0, eq));
+		const auto colon = key.rfind(':');
+		if (colon != std::string::npos) {
+			key = trim(key.substr(colon + 1));
+		}
+
+		std::string value = trim(line.substr(eq + 1));
+		if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front()) {
+			value = value.substr(1, value.size() - 2);
+		}
+
+		if (key.empty()) {
+			throw std::runtime_error("missing name in line " + std::to_string(number) + " of " + name);
+		}
+		set(key, value);
+	}
+}
+
+bool HTKConfig::has(const std::string& name) const
+{
+	return values_.find(upper(name)) != values_.end();
+}
+
+std::string HTKConfig::get(const std::string& name, const std::string& fallback) const
+{
+	auto it = values_.find(upper(name));
+	return it != values_.end() ? it->second : fallback;
+}
+
+double HTKConfig::get_number(const std::string& name, double fallback) const
+{
+	auto it = values_.find(upper(name));
+	if (it == values_.end()) {
+		return fallback;
+	}
+
+	char* end = nullptr;
+	const double value = std::strtod(it->second.c_str(), &end);
+	if (it->second.empty() || *end != '\0') {
+		throw std::runtime_error(it->first + " is not a number: " + it->second);
+	}
+	return value;
+}
+
+bool HTKConfig::get_bool(const std::string& name, bool fallback) const
+{
+	auto it = values_.find(upper(name));
+	if (it == values_.end()) {
+		return fallback;
+	}
+
+	const std::string value = upper(it->second);
+	if (value == "T" || value == "TRUE") {
+		return true;
+	}
+	if (value == "F" || value == "FALSE") {
+		return false;
+	}
+	throw std::runtime_error(it->first + " is not a boolean: " + it->second);
+}
+
+void HTKConfig::set(const std::string& name, const std::string& value)
+{
+	values_[upper(name)] = value;
+}
+
+HCopySettings HTKConfig::hcopy_settings() const
+{
+	HCopySettings s;
+	MFCC_HTK_Config& c = s.mfcc;
+
+	// the settings HCopy supports but MFCC_HTK does not
+	if (upper(get("SOURCEKIND", "WAVEFORM")) != "WAVEFORM") {
+		throw std::runtime_error("only SOURCEKIND = WAVEFORM is supported");
+	}
+	if (upper(get("SOURCEFORMAT", "NOHEAD")) != "NOHEAD") {
+		throw std::runtime_error("only SOURCEFORMAT = NOHEAD (raw 16-bit samples) is supported");
+	}
+	if (!get_bool("USEHAMMING", true) || get_bool("USEPOWER", false) || get_bool("ZMEANSOURCE", false) ||
+		get_number("ADDDITHER", 0.0) != 0.0 || get_bool("SIMPLEDIFFS", false)) {
+		throw std::runtime_error("USEHAMMING = F, USEPOWER = T, ZMEANSOURCE = T, ADDDITHER and SIMPLEDIFFS "
+			"are not supported");
+	}
+
+	const double source_rate = get_number("SOURCERATE", 0.0);
+	if (source_rate <= 0) {
+		throw std::runtime_error("SOURCERATE must be set");
+	}
+	s.target_rate = static_cast<int32_t>(get_number("TARGETRATE", 100000.0));
+	c.filter_compatibility = true;
+	c.samp_freq = static_cast<int>(std::lround(1e7 / source_rate));
+	c.win_shift = samples(s.target_rate, source_rate);
+	c.win_len = samples(get_number("WINDOWSIZE", 256000.0), source_rate);
+	c.preemph = static_cast<float>(get_number("PREEMCOEF", 0.97));
+	c.filter_num = static_cast<int>(get_number("NUMCHANS", 20));
+	c.lo_freq = static_cast<int>(get_number("LOFREQ", -1));
+	c.hi_freq = static_cast<int>(get_number("HIFREQ", -1));
+	c.mfcc_num = static_cast<int>(get_number("NUMCEPS", 12));
+	c.lifter_num = static_cast<int>(get_number("CEPLIFTER", 22));
+	c.raw_energy = get_bool("RAWENERGY", true);
+	c.enormalise = get_bool("ENORMALISE", true);
+	c.escale = static_cast<float>(get_number("ESCALE", 0.1));
+	c.sil_floor = static_cast<float>(get_number("SILFLOOR", 50.0));
+
+	s.deltawin = static_cast<int>(get_number("DELTAWINDOW", 2));
+	if (static_cast<int>(get_number("ACCWINDOW", s.deltawin)) != s.deltawin ||
+		static_cast<int>(get_number("THIRDWINDOW", s.deltawin)) != s.deltawin) {
+		throw std::runtime_error("DELTAWINDOW, ACCWINDOW and THIRDWINDOW must be equal");
+	}
+
+	// TARGETKIND is the basic kind followed by qualifiers, e.g. MFCC_D_A_0
+	std::istringstream kind(upper(get("TARGETKIND", "ANON")));
+	std::string part;
+	std::getline(kind, s.basic_kind, '_');
+	while (std::getline(kind, part, '_')) {
+		s.qualifiers.insert(part);
+	}
+
+	if (s.basic_kind == "MFCC") {
+		c.feat_mfcc = true;
+		c.feat_melspec = false;
+	}
+	else if (s.basic_kind == "FBANK") {
+		if (s.qualifiers.count("0") != 0 || s.qualifiers.count("Z") != 0) {
+			throw std::runtime_error("FBANK_0 and FBANK_Z are not supported");
+		}
+		c.feat_mfcc = false;
+		c.feat_melspec = true;
+	}
+	else {
+		throw std::runtime_error("TARGETKIND " + s.basic_kind + " is not supported, use MFCC or FBANK");
+	}
+
+	for (const auto& q : s.qualifiers) {
+		if (q != "E" && q != "0" && q != "D" && q != "A" && q != "T" && q != "Z" && q != "C" && q != "K") {
+			throw std::runtime_error("the qualifier _" + q + " is not supported");
+		}
+	}
+
+	// _0 appends c0, _E the log energy; both is not supported by MFCC_HTK
+	const bool c0 = s.qualifiers.count("0") != 0;
+	const bool energy = s.qualifiers.count("E") != 0;
+	if (c0 && energy) {
+		throw std::runtime_error("TARGETKIND with both _E and _0 is not supported");
+	}
+	c.feat_energy = c0 || energy;
+	c.ceps_energy = c0;
+	c.cmn = s.qualifiers.count("Z") != 0;
+
+	s.delta_order = s.qualifiers.count("T") ? 3 : (s.qualifiers.count("A") ? 2 : (s.qualifiers.count("D") ? 1 : 0));
+	if ((s.qualifiers.count("T") && !s.qualifiers.count("A")) || (s.qualifiers.count("A") && !s.qualifiers.count("D"))) {
+		throw std::runtime_error("_A needs _D and _T needs _A");
+	}
+
+	if (get_bool("SAVECOMPRESSED", false)) {
+		s.qualifiers.insert("C");
+	}
+	if (get_bool("SAVEWITHCRC", true)) {
+		s.qualifiers.insert("K");
+	}
+	if (get_bool("NATURALWRITEORDER", false)) {
+		s.order = HTKByteOrder::natural;
+	}
+	return s;
+}
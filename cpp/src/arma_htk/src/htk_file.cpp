@@ -1,136 +1,366 @@
 #include "htk_file.h"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
-#include <iostream>
-
-int32_t read32(std::ifstream& f) {
-	int32_t val = 0;
-	f.read(reinterpret_cast<char*>(&val), sizeof(int32_t));
-#ifdef _MSC_VER
-	return _byteswap_ulong(val);
-#else
-	return __builtin_bswap32(val);
-#endif
+#include <stdexcept>
+#include <functional>
+#include <utility>
+#include "byteswap.h"
+#include "crc16.h"
+#include "htk_format.h"
+#include "htk_probe.h"
+#include "mapped_file.h"
+#include "stage_timer.h"
+#include "trace_events.h"
+
+template<typename eT>
+bool HTKFile_T<eT>::load(const std::string & filename, bool check_crc)
+{
+	TraceScope trace("htk_read");
+	MappedFile file;
+	try {
+		file = MappedFile(filename);
+	}
+	catch (const std::runtime_error&) {
+		return false;
+	}
+
+	try {
+		load_memory(file.data(), file.size(), check_crc);
+	}
+	catch (const std::runtime_error& e) {
+		throw std::runtime_error(e.what() + (" in " + filename));
+	}
+	return true;
 }
 
-int16_t read16(std::ifstream& f) {
-	int16_t val = 0;
-	f.read(reinterpret_cast<char*>(&val), sizeof(int16_t));
-#ifdef _MSC_VER
-	return _byteswap_ushort(val);
-#else
-	return __builtin_bswap16(val);
-#endif
+template<typename eT>
+void HTKFile_T<eT>::load_memory(const char* data, std::size_t size, bool check_crc)
+{
+	read_memory(data, size, check_crc, nullptr);
 }
 
-float readfloat(std::ifstream& f) {
-	int32_t val = read32(f);
-	return *reinterpret_cast<float*>(&val);
+template<typename eT>
+void HTKFile_T<eT>::load_memory(const char* data, std::size_t size, eT* dst, bool check_crc)
+{
+	data_.reset();
+	read_memory(data, size, check_crc, dst);
 }
 
-bool HTKFile::load(const std::string & filename)
+template<typename eT>
+void HTKFile_T<eT>::read_memory(const char* data, std::size_t size, bool check_crc, eT* dst)
 {
-	std::ifstream f;
-	f.open(filename, std::ios::in | std::ios::binary);
-	if (!f) {
-		return false;
+	if (size < htk_header_size) {
+		throw std::runtime_error("unexpected end of file");
 	}
+	parse_header(data);
+	STAGE_TIMER(htk_load, nSamples_);
+	const char* p = data + htk_header_size;
 
-	uint16_t sampSize;
-	uint16_t paramKind;
-
-	nSamples_ = read32(f);
-	sampPeriod_ = read32(f);
-	sampSize = read16(f);
-	paramKind = read16(f);
-
-	std::string kinds[] = {"WAVEFORM", "LPC", "LPREFC", "LPCEPSTRA", "LPDELCEP", "IREFC", 
-		"MFCC", "FBANK", "MELSPEC", "USER", "DISCRETE", "PLP", "ERROR"};
-	basicKind_ = kinds[paramKind & 0x3F];
-
-	if ((paramKind & 0100) != 0)
-		qualifiers_.insert("E");
-	if ((paramKind & 0200) != 0)
-		qualifiers_.insert("N");
-	if ((paramKind & 0400) != 0)
-		qualifiers_.insert("D");
-	if ((paramKind & 01000) != 0)
-		qualifiers_.insert("A");
-	if ((paramKind & 02000) != 0)
-		qualifiers_.insert("C");
-	if ((paramKind & 04000) != 0)
-		qualifiers_.insert("Z");
-	if ((paramKind & 010000) != 0)
-		qualifiers_.insert("K");
-	if ((paramKind & 020000) != 0)
-		qualifiers_.insert("0");
-	if ((paramKind & 040000) != 0)
-		qualifiers_.insert("V");
-	if ((paramKind & 0100000) != 0)
-		qualifiers_.insert("T");
-
-	nFeatures_ = sampSize;
-	if (qualifiers_.find("C") != qualifiers_.end() ||
-		qualifiers_.find("V") != qualifiers_.end() ||
-		basicKind_ == "IREFC" || basicKind_ == "WAVEFORM") {
-		nFeatures_ = sampSize / 2;
+	// the whole payload is checked against the header once
+	const std::size_t scale_size = scale_bytes();
+	const std::size_t payload_size = scale_size + static_cast<std::size_t>(nSamples_) * sample_bytes();
+	if (size - htk_header_size < payload_size) {
+		throw std::runtime_error("unexpected end of file");
 	}
-	else {
-		nFeatures_ = sampSize / 4;
+
+	if (check_crc && qualifiers_.find("K") != qualifiers_.end()) {
+		if (size - htk_header_size < payload_size + 2) {
+			throw std::runtime_error("unexpected end of file");
+		}
+		if (crc16_update(0, p, payload_size) != read16(p + payload_size, order_ == HTKByteOrder::big_endian)) {
+			throw std::runtime_error("CRC mismatch");
+		}
+		STAGE_BYTES_READ(2);
 	}
 
-	if (qualifiers_.find("C") != qualifiers_.end()) {
-		nSamples_ -= 4;
+	STAGE_BYTES_READ(htk_header_size + payload_size);
+	decode_samples(p, p + scale_size, nSamples_, dst);
+}
+
+template<typename eT>
+bool HTKFile_T<eT>::load_range(const std::string& filename, int32_t first, int32_t last)
+{
+	std::ifstream in(filename, std::ios::binary);
+	if (!in) {
+		return false;
 	}
+	char header[htk_header_size];
+	const bool complete = static_cast<bool>(in.read(header, htk_header_size));
+	in.close();
 
-	if (qualifiers_.find("V") != qualifiers_.end()) {
+	try {
+		if (!complete) {
+			throw std::runtime_error("unexpected end of file");
+		}
+
+		// the file is read into another object, so this one is unchanged if anything throws
+		HTKFile_T<eT> range(layout_, order_);
+		range.parse_header(header);
+		if (first < 0 || first > last || last > range.nSamples_) {
+			throw std::runtime_error("sample range out of bounds");
+		}
+
+		// one mapping from the scales A and B of a compressed file to the last requested sample,
+		// of which only the scales and the requested samples are read
+		const std::size_t scale_size = range.scale_bytes();
+		const std::size_t sample_size = range.sample_bytes();
+		const std::size_t skipped = scale_size > 0 ? 0 : static_cast<std::size_t>(first) * sample_size;
+		const MappedFile file(filename, htk_header_size + skipped,
+			scale_size + static_cast<std::size_t>(last) * sample_size - skipped);
+		const char* samples = file.data() + scale_size + static_cast<std::size_t>(first) * sample_size - skipped;
+
+		range.nSamples_ = last - first;
+		STAGE_TIMER(htk_load, range.nSamples_);
+		STAGE_BYTES_READ(htk_header_size + scale_size + static_cast<std::size_t>(range.nSamples_) * sample_size);
+		range.decode_samples(file.data(), samples, range.nSamples_, nullptr);
+		*this = std::move(range);
+	}
+	catch (const std::runtime_error& e) {
+		throw std::runtime_error(e.what() + (" in " + filename));
+	}
+	return true;
+}
+
+template<typename eT>
+void HTKFile_T<eT>::parse_header(const char* p)
+{
+	HTKHeader header;
+	const bool valid = parse_htk_header(p, header, order_);
+	decode_param_kind(header.param_kind, basicKind_, qualifiers_);
+	nSamples_ = header.samples;
+	nFeatures_ = header.features();
+	sampPeriod_ = header.samp_period;
+
+	if (header.has(htk_kind::V)) {
 		throw std::runtime_error("VQ is not implemented");
 	}
-	
 
-	data_.reshape(nSamples_, nFeatures_);
+	if (!valid) {
+		throw std::runtime_error("invalid number of samples");
+	}
+}
+
+template<typename eT>
+std::size_t HTKFile_T<eT>::sample_bytes() const
+{
+	const bool shorts = qualifiers_.find("C") != qualifiers_.end() || is_short_kind(basicKind_);
+	return (shorts ? 2 : 4) * static_cast<std::size_t>(nFeatures_);
+}
+
+template<typename eT>
+std::size_t HTKFile_T<eT>::scale_bytes() const
+{
+	return qualifiers_.find("C") != qualifiers_.end() ? 2 * sizeof(float) * nFeatures_ : 0;
+}
+
+template<typename eT>
+void HTKFile_T<eT>::decode_samples(const char* scales, const char* p, int32_t count, eT* mem)
+{
+	const bool compressed = qualifiers_.find("C") != qualifiers_.end();
+	const bool shorts = compressed || is_short_kind(basicKind_);
+	const std::size_t n = nFeatures_;
+	const bool swap = order_ == HTKByteOrder::big_endian;
+
+	// element v of sample x
+	const bool frame_major = layout_ == FeatureLayout::frame_major;
+	if (mem == nullptr) {
+		STAGE_WATCH(eT, &data_);
+		if (frame_major) {
+			data_.set_size(nFeatures_, count);
+		}
+		else {
+			data_.set_size(count, nFeatures_);
+		}
+		mem = data_.memptr();
+	}
 
-	if (basicKind_ == "IREFC" || basicKind_ == "WAVEFORM") {
-		for (int x = 0; x < nSamples_; ++x) {
-			for (int v = 0; v < nFeatures_; ++v) {
-				int16_t val = read16(f);
-				data_(x, v) = val / 32767.0;
+	// decodes the values of one sample at a time straight into mem, or through a buffer
+	// when the features of a sample are not contiguous
+	std::vector<eT> row(frame_major ? 0 : nFeatures_);
+	auto decode = [&](const std::function<void(const char*, eT*)>& fn) {
+		const std::size_t stride = sample_bytes();
+		for (int32_t x = 0; x < count; ++x) {
+			if (frame_major) {
+				fn(p + x * stride, mem + x * n);
+			}
+			else {
+				fn(p + x * stride, row.data());
+				for (int32_t v = 0; v < nFeatures_; ++v) {
+					mem[x + v * static_cast<std::size_t>(count)] = row[v];
+				}
 			}
 		}
+	};
+
+	if (shorts && compressed) {
+		// x = (c + B) / A = c * (1 / A) + B / A, see HTK Book 5.10
+		std::vector<eT> scale(n), offset(n);
+		std::vector<float> A(n), B(n);
+		decode_be_floats(scales, n, A.data(), swap);
+		decode_be_floats(scales + 4 * n, n, B.data(), swap);
+		for (std::size_t v = 0; v < n; ++v) {
+			scale[v] = static_cast<eT>(1.0 / A[v]);
+			offset[v] = static_cast<eT>(B[v] / static_cast<double>(A[v]));
+		}
+
+		decode([&](const char* src, eT* dst) {
+			decode_be_shorts_affine(src, n, scale.data(), offset.data(), dst, swap);
+		});
+	}
+	else if (shorts) {
+		// x = c / 32767
+		decode([&](const char* src, eT* dst) {
+			decode_be_shorts_divided(src, n, 32767.0, dst, swap);
+		});
+	}
+	else if (frame_major) {
+		// the payload is the whole matrix in file order, a plain copy for floats in natural order
+		decode_be_floats(p, static_cast<std::size_t>(count) * n, mem, swap);
 	}
-	else if (qualifiers_.find("C") != qualifiers_.end()) {
-		std::vector<float> A(nFeatures_, 0.0f);
-		for (int x = 0; x < nFeatures_; ++x) {
-			float v = readfloat(f);
-			A.push_back(v);
+	else {
+		decode([&](const char* src, eT* dst) {
+			decode_be_floats(src, n, dst, swap);
+		});
+	}
+}
+
+template<typename eT>
+void HTKFile_T<eT>::set_data(const mat_type& data, int32_t samp_period, const std::string& basic_kind,
+	const std::set<std::string>& qualifiers)
+{
+	// checks the names
+	encode_param_kind(basic_kind, qualifiers);
+	if (qualifiers.count("V") != 0) {
+		throw std::runtime_error("VQ is not implemented");
+	}
+
+	data_ = data;
+	const bool frame_major = layout_ == FeatureLayout::frame_major;
+	nSamples_ = static_cast<int32_t>(frame_major ? data_.n_cols : data_.n_rows);
+	nFeatures_ = static_cast<int32_t>(frame_major ? data_.n_rows : data_.n_cols);
+	sampPeriod_ = samp_period;
+	basicKind_ = basic_kind;
+	qualifiers_ = qualifiers;
+}
+
+template<typename eT>
+bool HTKFile_T<eT>::save(const std::string& filename) const
+{
+	TraceScope trace("htk_write");
+	std::ofstream f(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!f) {
+		return false;
+	}
+
+	save(f);
+	f.close();
+	return !f.fail();
+}
+
+template<typename eT>
+void HTKFile_T<eT>::save(std::ostream& f) const
+{
+	const bool compressed = qualifiers_.find("C") != qualifiers_.end();
+	const bool shorts = compressed || is_short_kind(basicKind_);
+	const bool crc = qualifiers_.find("K") != qualifiers_.end();
+	const std::size_t n = nFeatures_;
+	const std::size_t value_size = shorts ? 2 : 4;
+	const bool swap = order_ == HTKByteOrder::big_endian;
+	STAGE_TIMER(htk_save, nSamples_);
+
+	uint16_t paramKind = encode_param_kind(basicKind_, qualifiers_);
+	if (value_size * n > 0xFFFF) {
+		throw std::runtime_error("too many features per sample");
+	}
+
+	// the header is not part of the CRC
+	char header[htk_header_size];
+	write32(static_cast<uint32_t>(nSamples_ + (compressed ? 4 : 0)), header, swap);
+	write32(static_cast<uint32_t>(sampPeriod_), header + 4, swap);
+	write16(static_cast<uint16_t>(value_size * n), header + 8, swap);
+	write16(paramKind, header + 10, swap);
+	f.write(header, sizeof(header));
+
+	// the payload is encoded into large blocks, each written with a single call
+	std::vector<char> buf;
+	buf.reserve(htk_write_block + value_size * n);
+	uint16_t sum = 0;
+	auto flush = [&]() {
+		sum = crc16_update(sum, buf.data(), buf.size());
+		f.write(buf.data(), buf.size());
+		buf.clear();
+	};
+	auto append = [&](std::size_t bytes) {
+		buf.resize(buf.size() + bytes);
+		return buf.data() + buf.size() - bytes;
+	};
+
+	// the features of sample x, contiguous
+	const bool frame_major = layout_ == FeatureLayout::frame_major;
+	std::vector<eT> row(frame_major ? 0 : n);
+	auto sample = [&](int32_t x) -> const eT* {
+		if (frame_major) {
+			return data_.colptr(x);
 		}
-		std::vector<float> B(nFeatures_, 0.0f);
-		for (int x = 0; x < nFeatures_; ++x) {
-			float v = readfloat(f);
-			B.push_back(v);
+		for (std::size_t v = 0; v < n; ++v) {
+			row[v] = data_(x, v);
 		}
+		return row.data();
+	};
 
-		for (int x = 0; x < nSamples_; ++x) {
-			for (int v = 0; v < nFeatures_; ++v) {
-				int16_t val = read16(f);
-				data_(x, v) = val + B[v] / A[v];
+	std::vector<int16_t> codes(shorts ? n : 0);
+	std::vector<float> A, B;
+	if (compressed) {
+		// every feature is scaled to [-32767, 32767], x = (c + B) / A, see HTK Book 5.10
+		A.resize(n);
+		B.resize(n);
+		for (std::size_t v = 0; v < n; ++v) {
+			double xmin = 0, xmax = 0;
+			for (int32_t x = 0; x < nSamples_; ++x) {
+				double val = frame_major ? data_(v, x) : data_(x, v);
+				xmin = (x == 0) ? val : std::min(xmin, val);
+				xmax = (x == 0) ? val : std::max(xmax, val);
+			}
+			if (xmax > xmin) {
+				A[v] = static_cast<float>(2 * 32767 / (xmax - xmin));
+				B[v] = static_cast<float>((xmax + xmin) * 32767 / (xmax - xmin));
+			}
+			else {
+				A[v] = 1.0f;
+				B[v] = static_cast<float>(xmax);
 			}
 		}
+		encode_be_floats(A.data(), n, append(4 * n), swap);
+		encode_be_floats(B.data(), n, append(4 * n), swap);
 	}
-	else {
-		for (int x = 0; x < nSamples_; ++x) {
-			for (int v = 0; v < nFeatures_; ++v) {
-				float val = readfloat(f);
-				data_(x, v) = val;
-				if (f.eof()) {
-					throw std::runtime_error("unexpected end of file");
-				}
+
+	for (int32_t x = 0; x < nSamples_; ++x) {
+		const eT* s = sample(x);
+		char* dst = append(value_size * n);
+		if (compressed) {
+			for (std::size_t v = 0; v < n; ++v) {
+				double c = std::round(static_cast<double>(s[v]) * A[v] - B[v]);
+				codes[v] = static_cast<int16_t>(std::min(32767.0, std::max(-32767.0, c)));
 			}
+			encode_be_shorts(codes.data(), n, dst, swap);
+		}
+		else {
+			encode_sample(s, n, shorts, codes.data(), dst, swap);
+		}
+		if (buf.size() >= htk_write_block) {
+			flush();
 		}
 	}
+	flush();
 
-	if (qualifiers_.find("K") != qualifiers_.end()) {
-		std::cout << "CRC checking not implememnted...";
+	if (crc) {
+		char tail[2];
+		write16(sum, tail, swap);
+		f.write(tail, sizeof(tail));
 	}
 
-	return true;
 }
+
+template class HTKFile_T<double>;
+template class HTKFile_T<float>;
@@ -0,0 +1,87 @@
+#include "htk_format.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+#include "byteswap.h"
+
+namespace {
+
+	const int basic_kind_num = 13;
+
+	const char* const basic_kinds[basic_kind_num] = {"WAVEFORM", "LPC", "LPREFC", "LPCEPSTRA", "LPDELCEP",
+		"IREFC", "MFCC", "FBANK", "MELSPEC", "USER", "DISCRETE", "PLP", "ERROR"};
+
+	struct QualifierBit {
+		const char* name;
+		uint16_t bit;
+	};
+
+	const QualifierBit qualifier_bits[] = {{"E", 0100}, {"N", 0200}, {"D", 0400}, {"A", 01000},
+		{"C", 02000}, {"Z", 04000}, {"K", 010000}, {"0", 020000}, {"V", 040000}, {"T", 0100000}};
+}
+
+void decode_param_kind(uint16_t kind, std::string& basic_kind, std::set<std::string>& qualifiers)
+{
+	basic_kind = basic_kinds[std::min(kind & 0x3F, basic_kind_num - 1)];
+
+	qualifiers.clear();
+	for (const auto& q : qualifier_bits) {
+		if ((kind & q.bit) != 0)
+			qualifiers.insert(q.name);
+	}
+}
+
+uint16_t encode_param_kind(const std::string& basic_kind, const std::set<std::string>& qualifiers)
+{
+	auto kind = std::find(basic_kinds, basic_kinds + basic_kind_num, basic_kind);
+	if (kind == basic_kinds + basic_kind_num) {
+		throw std::runtime_error("unknown parameter kind " + basic_kind);
+	}
+
+	uint16_t ret = static_cast<uint16_t>(kind - basic_kinds);
+	for (const auto& q : qualifiers) {
+		auto it = std::find_if(std::begin(qualifier_bits), std::end(qualifier_bits),
+			[&](const QualifierBit& b) { return q == b.name; });
+		if (it == std::end(qualifier_bits)) {
+			throw std::runtime_error("unknown qualifier " + q);
+		}
+		ret |= it->bit;
+	}
+	return ret;
+}
+
+std::string param_kind_name(uint16_t kind)
+{
+	std::string name = basic_kinds[std::min(kind & 0x3F, basic_kind_num - 1)];
+	for (const auto& q : qualifier_bits) {
+		if ((kind & q.bit) != 0) {
+			name += '_';
+			name += q.name;
+		}
+	}
+	return name;
+}
+
+bool is_short_kind(const std::string& basic_kind)
+{
+	return basic_kind == "IREFC" || basic_kind == "WAVEFORM";
+}
+
+template<typename T>
+void encode_sample(const T* src, std::size_t n, bool shorts, int16_t* codes, char* dst, bool swap)
+{
+	if (shorts) {
+		for (std::size_t v = 0; v < n; ++v) {
+			double c = std::round(src[v] * 32767.0);
+			codes[v] = static_cast<int16_t>(std::min(32767.0, std::max(-32768.0, c)));
+		}
+		encode_be_shorts(codes, n, dst, swap);
+	}
+	else {
+		encode_be_floats(src, n, dst, swap);
+	}
+}
+
+template void encode_sample<double>(const double*, std::size_t, bool, int16_t*, char*, bool);
+template void encode_sample<float>(const float*, std::size_t, bool, int16_t*, char*, bool);
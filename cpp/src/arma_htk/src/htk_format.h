@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	htk_format.h
+//
+// summary:	Helpers shared by the HTK file reader and writers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+
+/// <summary>	Size of the HTK file header. </summary>
+const std::size_t htk_header_size = 12;
+
+/// <summary>	Size of the blocks written to HTK files. </summary>
+const std::size_t htk_write_block = 1 << 20;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Splits a parameter kind into the basic kind and the qualifiers. </summary>
+///
+/// <param name="kind">		 	The parameter kind of the header. </param>
+/// <param name="basic_kind">	Receives the basic kind, e.g. "MFCC" ("ERROR" if unknown). </param>
+/// <param name="qualifiers">	Receives the qualifiers, e.g. {"0", "D", "A"}. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void decode_param_kind(uint16_t kind, std::string& basic_kind, std::set<std::string>& qualifiers);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Builds a parameter kind. Throws std::runtime_error for unknown names. </summary>
+///
+/// <param name="basic_kind">	The basic kind. </param>
+/// <param name="qualifiers">	The qualifiers. </param>
+///
+/// <returns>	The parameter kind of the header. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t encode_param_kind(const std::string& basic_kind, const std::set<std::string>& qualifiers);
+
+/// <summary>	Whether the samples of the basic kind are stored as 16-bit integers. </summary>
+bool is_short_kind(const std::string& basic_kind);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Encodes the features of one uncompressed sample. </summary>
+///
+/// <param name="src">   	The features, float or double. </param>
+/// <param name="n">	 	Number of features. </param>
+/// <param name="shorts">	Store 16-bit integers scaled by 32767 instead of floats. </param>
+/// <param name="codes"> 	Scratch for n integers (only used with shorts). </param>
+/// <param name="dst">   	Receives the big-endian sample. </param>
+/// <param name="swap">  	(Optional) false to write in the byte order of the machine. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+void encode_sample(const T* src, std::size_t n, bool shorts, int16_t* codes, char* dst, bool swap = true);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Names a parameter kind like HList, e.g. "MFCC_D_A_0". </summary>
+///
+/// <param name="kind">	The parameter kind of the header. </param>
+///
+/// <returns>	The basic kind followed by the qualifiers, separated by underscores. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string param_kind_name(uint16_t kind);
@@ -0,0 +1,189 @@
+#include "htk_probe.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "byteswap.h"
+#include "htk_format.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+int HTKHeader::features() const
+{
+	const bool shorts = has(htk_kind::C) || has(htk_kind::V) ||
+		basic_kind() == htk_kind::WAVEFORM || basic_kind() == htk_kind::IREFC;
+	return sample_size / (shorts ? 2 : 4);
+}
+
+std::string HTKHeader::kind_name() const
+{
+	return param_kind_name(param_kind);
+}
+
+bool parse_htk_header(const char* p, HTKHeader& header, HTKByteOrder order)
+{
+	const bool swap = order == HTKByteOrder::big_endian;
+	header.samples = static_cast<int32_t>(read32(p, swap));
+	header.samp_period = static_cast<int32_t>(read32(p + 4, swap));
+	header.sample_size = read16(p + 8, swap);
+	header.param_kind = read16(p + 10, swap);
+
+	// the scales A and B of a compressed file count as 4 samples
+	if (header.has(htk_kind::C)) {
+		header.samples -= 4;
+	}
+	return header.samples >= 0;
+}
+
+bool probe_htk(const std::string& filename, HTKHeader& header, HTKByteOrder order)
+{
+	std::FILE* f = std::fopen(filename.c_str(), "rb");
+	if (f == nullptr) {
+		return false;
+	}
+
+	// unbuffered, so only the header is read from the disk
+	std::setvbuf(f, nullptr, _IONBF, 0);
+	char data[htk_header_size];
+	const bool ok = std::fread(data, 1, sizeof(data), f) == sizeof(data);
+	std::fclose(f);
+	return ok && parse_htk_header(data, header, order);
+}
+
+std::vector<HTKManifestEntry> scan_htk(const std::vector<std::string>& paths, int threads, HTKByteOrder order)
+{
+	std::vector<HTKManifestEntry> entries(paths.size());
+	ThreadPool pool(threads);
+	pool.parallel_for(paths.size(), [&](std::size_t i, int) {
+		entries[i].path = paths[i];
+		entries[i].ok = probe_htk(paths[i], entries[i].header, order);
+	});
+	return entries;
+}
+
+namespace {
+
+	bool ends_with(const std::string& s, const std::string& suffix)
+	{
+		return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	void list_dir(const std::string& dir, const std::string& extension, std::vector<std::string>& out)
+	{
+#ifdef _WIN32
+		WIN32_FIND_DATAA found;
+		HANDLE h = FindFirstFileA((dir + "\\*").c_str(), &found);
+		if (h == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("cannot read the directory " + dir);
+		}
+		do {
+			const std::string name = found.cFileName;
+			if (name == "." || name == "..") {
+				continue;
+			}
+			const std::string path = dir + "\\" + name;
+			if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+				// junctions and symlinked directories are not followed, they may form a cycle
+				if ((found.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) {
+					list_dir(path, extension, out);
+				}
+			}
+			else if (ends_with(name, extension)) {
+				out.push_back(path);
+			}
+		} while (FindNextFileA(h, &found));
+		FindClose(h);
+#else
+		DIR* d = ::opendir(dir.c_str());
+		if (d == nullptr) {
+			throw std::runtime_error("cannot read the directory " + dir);
+		}
+		std::vector<std::string> subdirs;
+		while (const dirent* e = ::readdir(d)) {
+			const std::string name = e->d_name;
+			if (name == "." || name == "..") {
+				continue;
+			}
+			const std::string path = dir + "/" + name;
+
+			// the type in the directory entry saves a stat per file, not all file systems set it
+			unsigned char type = e->d_type;
+			struct stat st;
+			if (type == DT_UNKNOWN && ::lstat(path.c_str(), &st) == 0) {
+				type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : DT_REG;
+			}
+
+			// symlinked directories are not followed, a link to a parent would recurse forever
+			if (type == DT_LNK && ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+				continue;
+			}
+
+			if (type == DT_DIR) {
+				subdirs.push_back(path);
+			}
+			else if (ends_with(name, extension)) {
+				out.push_back(path);
+			}
+		}
+		::closedir(d);
+
+		for (const auto& sub : subdirs) {
+			list_dir(sub, extension, out);
+		}
+#endif
+	}
+}
+
+std::vector<std::string> list_htk_dir(const std::string& dir, const std::string& extension)
+{
+	std::vector<std::string> paths;
+	list_dir(dir, extension, paths);
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+std::vector<std::string> read_htk_script(const std::string& filename)
+{
+	std::ifstream f(filename);
+	if (!f) {
+		throw std::runtime_error("cannot open " + filename);
+	}
+
+	std::vector<std::string> paths;
+	std::string line;
+	while (std::getline(f, line)) {
+		std::istringstream words(line);
+		std::string word, last;
+		while (words >> word) {
+			last = word;
+		}
+		if (!last.empty()) {
+			paths.push_back(last);
+		}
+	}
+	return paths;
+}
+
+std::size_t write_htk_manifest(std::ostream& out, const std::vector<HTKManifestEntry>& entries)
+{
+	std::size_t written = 0;
+	for (const auto& e : entries) {
+		if (!e.ok) {
+			continue;
+		}
+		out << e.path << '\t' << e.header.samples << '\t' << e.header.features() << '\t'
+			<< e.header.samp_period << '\t' << e.header.kind_name() << '\n';
+		++written;
+	}
+	return written;
+}
@@ -0,0 +1,242 @@
+#include "htk_writer.h"
+#include <stdexcept>
+#include "byteswap.h"
+#include "crc16.h"
+#include "htk_format.h"
+
+namespace {
+
+	/// <summary>	Number of full blocks that may wait for the background thread. </summary>
+	const std::size_t max_pending = 4;
+}
+
+HTKWriter::HTKWriter(const std::string& filename, int features, int32_t samp_period, const std::string& basic_kind,
+	const std::set<std::string>& qualifiers, bool append, HTKByteOrder order)
+	: swap_(order == HTKByteOrder::big_endian), features_(features), samples_(0), open_(false), sum_(0), closing_(false)
+{
+	if (qualifiers.count("C") != 0) {
+		throw std::runtime_error("compression needs the whole file, use HTKFile::save");
+	}
+	if (qualifiers.count("V") != 0) {
+		throw std::runtime_error("VQ is not implemented");
+	}
+
+	const uint16_t kind = encode_param_kind(basic_kind, qualifiers);
+	shorts_ = is_short_kind(basic_kind);
+	crc_ = qualifiers.count("K") != 0;
+	sample_size_ = (shorts_ ? 2 : 4) * static_cast<std::size_t>(features);
+	if (features <= 0 || sample_size_ > 0xFFFF) {
+		throw std::runtime_error("invalid number of features");
+	}
+
+	if (append) {
+		file_.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+	}
+
+	if (file_.is_open()) {
+		// continue after the samples (and before the CRC) of the existing file
+		char header[htk_header_size];
+		file_.seekg(0, std::ios::end);
+		const std::streamoff size = file_.tellg();
+		file_.seekg(0);
+		if (size < static_cast<std::streamoff>(htk_header_size) || !file_.read(header, sizeof(header))) {
+			throw std::runtime_error("cannot read the header of " + filename);
+		}
+		if (read16(header + 8, swap_) != sample_size_ || read16(header + 10, swap_) != kind) {
+			throw std::runtime_error("cannot append to " + filename + ", the parameter kind differs");
+		}
+		if (static_cast<int32_t>(read32(header + 4, swap_)) != samp_period) {
+			throw std::runtime_error("cannot append to " + filename + ", the sample period differs");
+		}
+		samples_ = static_cast<int32_t>(read32(header, swap_));
+
+		std::streamoff end = htk_header_size + static_cast<std::streamoff>(samples_) * sample_size_;
+		if (samples_ < 0 || size != end + (crc_ ? 2 : 0)) {
+			throw std::runtime_error("cannot append to " + filename + ", the size does not match the header");
+		}
+		if (crc_) {
+			// the CRC has no final xor, so the stored value continues over the new samples
+			char tail[2];
+			file_.seekg(end);
+			file_.read(tail, sizeof(tail));
+			sum_ = read16(tail, swap_);
+		}
+		file_.seekp(end);
+	}
+	else {
+		file_.clear();
+		file_.open(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file_.is_open()) {
+			throw std::runtime_error("cannot open " + filename);
+		}
+
+		// the number of samples is written by close
+		char header[htk_header_size];
+		write32(0, header, swap_);
+		write32(static_cast<uint32_t>(samp_period), header + 4, swap_);
+		write16(static_cast<uint16_t>(sample_size_), header + 8, swap_);
+		write16(kind, header + 10, swap_);
+		file_.write(header, sizeof(header));
+	}
+	if (!file_) {
+		throw std::runtime_error("cannot write " + filename);
+	}
+
+	open_ = true;
+	block_.reserve(htk_write_block + sample_size_);
+	codes_.resize(shorts_ ? features_ : 0);
+	thread_ = std::thread(&HTKWriter::flusher, this);
+}
+
+HTKWriter::~HTKWriter()
+{
+	try {
+		close();
+	}
+	catch (...) {
+	}
+}
+
+void HTKWriter::write(const double* sample)
+{
+	if (!open_) {
+		throw std::runtime_error("the file is closed");
+	}
+
+	block_.resize(block_.size() + sample_size_);
+	encode_sample(sample, features_, shorts_, codes_.data(), block_.data() + block_.size() - sample_size_,
+		swap_);
+	++samples_;
+
+	if (block_.size() >= htk_write_block) {
+		submit();
+	}
+}
+
+void HTKWriter::write(const arma::mat& samples, FeatureLayout layout)
+{
+	if (layout == FeatureLayout::frame_major) {
+		if (samples.n_rows != static_cast<arma::uword>(features_)) {
+			throw std::runtime_error("wrong number of features");
+		}
+		for (arma::uword x = 0; x < samples.n_cols; ++x) {
+			write(samples.colptr(x));
+		}
+	}
+	else {
+		if (samples.n_cols != static_cast<arma::uword>(features_)) {
+			throw std::runtime_error("wrong number of features");
+		}
+		row_.resize(features_);
+		for (arma::uword x = 0; x < samples.n_rows; ++x) {
+			for (int v = 0; v < features_; ++v) {
+				row_[v] = samples(x, v);
+			}
+			write(row_.data());
+		}
+	}
+}
+
+void HTKWriter::write(const arma::fmat& samples, FeatureLayout layout)
+{
+	const bool frame_major = layout == FeatureLayout::frame_major;
+	if ((frame_major ? samples.n_rows : samples.n_cols) != static_cast<arma::uword>(features_)) {
+		throw std::runtime_error("wrong number of features");
+	}
+	row_.resize(features_);
+	const arma::uword n = frame_major ? samples.n_cols : samples.n_rows;
+	for (arma::uword x = 0; x < n; ++x) {
+		for (int v = 0; v < features_; ++v) {
+			row_[v] = frame_major ? samples(v, x) : samples(x, v);
+		}
+		write(row_.data());
+	}
+}
+
+void HTKWriter::submit()
+{
+	std::vector<char> next;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [&] { return pending_.size() < max_pending || error_; });
+		if (error_) {
+			std::rethrow_exception(error_);
+		}
+		pending_.push_back(std::move(block_));
+		if (!spare_.empty()) {
+			next = std::move(spare_.back());
+			spare_.pop_back();
+		}
+	}
+	cv_.notify_all();
+
+	next.clear();
+	next.reserve(htk_write_block + sample_size_);
+	block_ = std::move(next);
+}
+
+void HTKWriter::flusher()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+		cv_.wait(lock, [&] { return !pending_.empty() || closing_; });
+		if (pending_.empty()) {
+			return;
+		}
+
+		std::vector<char> block = std::move(pending_.front());
+		pending_.pop_front();
+		lock.unlock();
+
+		if (!error_) {
+			sum_ = crc16_update(sum_, block.data(), block.size());
+			file_.write(block.data(), block.size());
+		}
+
+		lock.lock();
+		if (!file_ && !error_) {
+			error_ = std::make_exception_ptr(std::runtime_error("cannot write the HTK file"));
+		}
+		spare_.push_back(std::move(block));
+		cv_.notify_all();
+	}
+}
+
+void HTKWriter::close()
+{
+	if (!open_) {
+		return;
+	}
+	open_ = false;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!block_.empty()) {
+			pending_.push_back(std::move(block_));
+		}
+		closing_ = true;
+	}
+	cv_.notify_all();
+	thread_.join();
+
+	if (error_) {
+		file_.close();
+		std::rethrow_exception(error_);
+	}
+
+	if (crc_) {
+		char tail[2];
+		write16(sum_, tail, swap_);
+		file_.write(tail, sizeof(tail));
+	}
+
+	char count[4];
+	write32(static_cast<uint32_t>(samples_), count, swap_);
+	file_.seekp(0);
+	file_.write(count, sizeof(count));
+	file_.close();
+
+	if (file_.fail()) {
+		throw std::runtime_error("cannot write the HTK file");
+	}
+}
@@ -0,0 +1,155 @@
+#include "mapped_file.h"
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename)
+	: data_(nullptr), size_(0), base_(nullptr), mapped_(0)
+{
+	open(filename, 0, 0, true);
+}
+
+MappedFile::MappedFile(const std::string& filename, std::size_t offset, std::size_t length)
+	: data_(nullptr), size_(0), base_(nullptr), mapped_(0)
+{
+	open(filename, offset, length, false);
+}
+
+void MappedFile::open(const std::string& filename, std::size_t offset, std::size_t length, bool whole)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, whole ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("cannot open " + filename);
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw std::runtime_error("cannot get the size of " + filename);
+	}
+	const std::size_t file_size = static_cast<std::size_t>(size.QuadPart);
+	if (whole) {
+		length = file_size;
+	}
+	if (offset > file_size || length > file_size - offset) {
+		CloseHandle(file);
+		throw std::runtime_error("unexpected end of file " + filename);
+	}
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	const std::size_t start = offset - offset % info.dwAllocationGranularity;
+
+	// an empty range cannot be mapped
+	if (length > 0) {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			const uint64_t at = start;
+			base_ = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(at >> 32),
+				static_cast<DWORD>(at & 0xFFFFFFFF), offset - start + length);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+
+	if (length > 0 && base_ == nullptr) {
+		throw std::runtime_error("cannot map " + filename);
+	}
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("cannot open " + filename);
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::runtime_error("cannot get the size of " + filename);
+	}
+	const std::size_t file_size = static_cast<std::size_t>(st.st_size);
+	if (whole) {
+		length = file_size;
+	}
+	if (offset > file_size || length > file_size - offset) {
+		::close(fd);
+		throw std::runtime_error("unexpected end of file " + filename);
+	}
+
+	const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+	const std::size_t start = offset - offset % page;
+
+	// an empty range cannot be mapped
+	if (length > 0) {
+		void* p = ::mmap(nullptr, offset - start + length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(start));
+		if (p == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("cannot map " + filename);
+		}
+		base_ = p;
+		// a whole file is read front to back, a part is usually small
+		::madvise(p, offset - start + length, whole ? MADV_SEQUENTIAL : MADV_WILLNEED);
+	}
+	::close(fd);
+#endif
+
+	if (length > 0) {
+		mapped_ = offset - start + length;
+		data_ = static_cast<const char*>(base_) + (offset - start);
+		size_ = length;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+	: data_(other.data_), size_(other.size_), base_(other.base_), mapped_(other.mapped_)
+{
+	other.data_ = nullptr;
+	other.size_ = 0;
+	other.base_ = nullptr;
+	other.mapped_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	if (this != &other) {
+		close();
+		std::swap(data_, other.data_);
+		std::swap(size_, other.size_);
+		std::swap(base_, other.base_);
+		std::swap(mapped_, other.mapped_);
+	}
+	return *this;
+}
+
+void MappedFile::close()
+{
+	if (base_ != nullptr) {
+#ifdef _WIN32
+		UnmapViewOfFile(base_);
+#else
+		::munmap(base_, mapped_);
+#endif
+	}
+	data_ = nullptr;
+	size_ = 0;
+	base_ = nullptr;
+	mapped_ = 0;
+}
@@ -3,13 +3,19 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include "np_arma.h"
+#include "mapped_file.h"
 #include "gen_filt.h"
+#include "stage_timer.h"
+#include "trace_events.h"
 
-MFCC_HTK::MFCC_HTK(const Config & config)
-	: config_(config)
+template<typename eT>
+MFCC_HTK_T<eT>::MFCC_HTK_T(const Config & config)
+	: config_(config), filter_first_bin_(0)
 {
 	fft_len_ = static_cast<int>(pow(2, floor(log2(config_.win_len)) + 1));
+	fft_ = RealFFT<eT>(fft_len_);
 
 	// Fix out of range lo/hi freq
 	config_.lo_freq = std::max(0, config_.lo_freq);
@@ -25,19 +31,35 @@ MFCC_HTK::MFCC_HTK(const Config & config)
 		create_filter();
 	}
 
-	hamm_ = arma::hamming(config_.win_len);
+	if (config_.sparse_filter) {
+		create_sparse_filter();
+	}
+
+	// the tables are computed in double precision and then rounded to eT
+	hamm_ = arma::hamming<vec_type>(config_.win_len);
 
-	dct_base_ = arma::zeros<arma::mat>(config_.filter_num, config_.mfcc_num);
+	arma::mat dct_base = arma::zeros<arma::mat>(config_.filter_num, config_.mfcc_num);
 	for (int m = 0; m < config_.mfcc_num; ++m) {
-		dct_base_.col(m) = arma::cos((m + 1)*arma::datum::pi / config_.filter_num*(arma::arange(config_.filter_num) + 0.5));
+		dct_base.col(m) = arma::cos((m + 1)*arma::datum::pi / config_.filter_num*(arma::arange(config_.filter_num) + 0.5));
 	}
+	dct_base_ = arma::conv_to<mat_type>::from(dct_base);
+
+	arma::vec lifter = 1 + (config_.lifter_num / 2)*arma::sin(arma::datum::pi*(1 + arma::arange(config_.mfcc_num)) / config_.lifter_num);
+	lifter_ = arma::conv_to<vec_type>::from(lifter);
 
-	lifter_ = 1 + (config_.lifter_num / 2)*arma::sin(arma::datum::pi*(1 + arma::arange(config_.mfcc_num)) / config_.lifter_num);
+	mfnorm_ = static_cast<eT>(sqrt(2.0 / config_.filter_num));
 
-	mfnorm_ = sqrt(2.0 / config_.filter_num);
+	feat_num_ = (config_.feat_melspec ? config_.filter_num : 0) +
+		(config_.feat_mfcc ? config_.mfcc_num : 0) +
+		(config_.feat_energy ? 1 : 0);
+
+	if (config_.num_threads != 1) {
+		pool_ = std::make_shared<ThreadPool>(config_.num_threads);
+	}
 }
 
-arma::vec MFCC_HTK::load_raw_signal(std::string filename)
+template<typename eT>
+typename MFCC_HTK_T<eT>::vec_type MFCC_HTK_T<eT>::load_raw_signal(std::string filename)
 {
 	std::ifstream file;
 	file.open(filename, std::ios_base::in | std::ios_base::binary);
@@ -46,146 +68,516 @@ arma::vec MFCC_HTK::load_raw_signal(std::string filename)
 		arma::Col<arma::s16> content;
 		if (content.quiet_load(file, arma::raw_binary))
 		{
-			return arma::conv_to<arma::vec>::from(content);
+			return arma::conv_to<vec_type>::from(content);
 		}
 	}
-	return arma::vec();
+	return vec_type();
 }
 
-arma::mat MFCC_HTK::get_feats(arma::vec signal)
+template<typename eT>
+typename MFCC_HTK_T<eT>::mat_type MFCC_HTK_T<eT>::get_feats(const vec_type& signal)
 {
-	auto sig_len = signal.size();
-	auto win_num = (sig_len - config_.win_len) / config_.win_shift + 1;
-	
-	std::vector<arma::vec> feats;
+	std::vector<Workspace> ws(pool_ ? pool_->size() : 1);
+	return compute_feats(signal.memptr(), signal.n_elem, pool_.get(), ws.data());
+}
 
-	for (auto w = 0u; w < win_num; ++w) {
-		std::vector<arma::vec> featwin;
+template<typename eT>
+typename MFCC_HTK_T<eT>::mat_type MFCC_HTK_T<eT>::get_feats(const arma::s16* samples, arma::uword n)
+{
+	std::vector<Workspace> ws(pool_ ? pool_->size() : 1);
+	return compute_feats(samples, n, pool_.get(), ws.data());
+}
 
-		// extract window
-		auto s = w * config_.win_shift;
-		auto e = s + config_.win_len;
-		arma::vec win = signal.rows (s, e - 1);
+template<typename eT>
+typename MFCC_HTK_T<eT>::mat_type MFCC_HTK_T<eT>::get_feats(const float* samples, arma::uword n)
+{
+	std::vector<Workspace> ws(pool_ ? pool_->size() : 1);
+	return compute_feats(samples, n, pool_.get(), ws.data());
+}
 
-		// raw energy is calculated before any windowing or pre-emphasis
-		double energy;
-		if (config_.feat_energy && !config_.ceps_energy && config_.raw_energy) {
-			energy = ::log(arma::sum(arma::square(win)));
-		}
+template<typename eT>
+typename MFCC_HTK_T<eT>::mat_type MFCC_HTK_T<eT>::get_feats_raw(const std::string& filename)
+{
+	MappedFile file(filename);
+	return get_feats(file.as<arma::s16>(), file.count<arma::s16>());
+}
 
-		// preemphasis
-		win -= arma::hstack(arma::vec{ win[0] }, win.head_rows(win.n_rows - 1)) 
-			* config_.preemph;
+template<typename eT>
+std::vector<typename MFCC_HTK_T<eT>::mat_type> MFCC_HTK_T<eT>::get_feats_batch(const std::vector<vec_type>& signals)
+{
+	std::vector<arma::uword> lengths(signals.size());
+	for (std::size_t i = 0; i < signals.size(); ++i) {
+		lengths[i] = signals[i].n_elem;
+	}
 
-		// windowing
-		win %= hamm_;
+	return compute_batch(lengths, [&](std::size_t i, Workspace& ws) {
+		return compute_feats(signals[i].memptr(), signals[i].n_elem, nullptr, &ws);
+	});
+}
 
-		// for energy calculations
-		arma::vec sig_win = win;
+template<typename eT>
+std::vector<typename MFCC_HTK_T<eT>::mat_type> MFCC_HTK_T<eT>::get_feats_batch(const std::vector<std::string>& filenames)
+{
+	std::vector<arma::uword> lengths(filenames.size());
+	for (std::size_t i = 0; i < filenames.size(); ++i) {
+		std::ifstream f(filenames[i], std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+		lengths[i] = f ? static_cast<arma::uword>(f.tellg()) : 0;
+	}
 
-		// fft
-		win = arma::abs(arma::fft(win, fft_len_));
-		win = win.head_rows(filter_mat_.n_rows);
+	return compute_batch(lengths, [&](std::size_t i, Workspace& ws) {
+		MappedFile file(filenames[i]);
+		return compute_feats(file.as<arma::s16>(), file.count<arma::s16>(), nullptr, &ws);
+	});
+}
 
-		// filters
-		arma::vec melspec = (win.t() * filter_mat_).t();
+template<typename eT>
+std::vector<typename MFCC_HTK_T<eT>::mat_type> MFCC_HTK_T<eT>::compute_batch(const std::vector<arma::uword>& lengths,
+	const std::function<mat_type(std::size_t, Workspace&)>& fn) const
+{
+	std::vector<mat_type> results(lengths.size());
 
-		// floor (before log)
-		melspec(arma::find(melspec < 0.001)).fill(0.001);
+	// longest first, so the short ones fill the gaps at the end
+	std::vector<std::size_t> order(lengths.size());
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		return lengths[a] > lengths[b];
+	});
 
-		// log
-		melspec = arma::log(melspec);
+	std::vector<Workspace> ws(pool_ ? pool_->size() : 1);
+	auto body = [&](std::size_t i, int slot) {
+		results[i] = fn(i, ws[slot]);
+	};
 
-		if (config_.feat_melspec) {
-			featwin.push_back(melspec);
+	if (pool_) {
+		pool_->parallel_for_stealing(order, body);
+	}
+	else {
+		for (auto i : order) {
+			body(i, 0);
 		}
+	}
 
-		// dct
-		arma::vec mfcc = (melspec.t() * dct_base_).t();
-		mfcc *= mfnorm_;
+	return results;
+}
 
-		// lifter
-		mfcc %= lifter_;
+template<typename eT>
+template<typename S>
+typename MFCC_HTK_T<eT>::mat_type MFCC_HTK_T<eT>::compute_feats(const S* signal, arma::uword sig_len,
+	ThreadPool* pool, Workspace* ws) const
+{
+	TraceScope trace("get_feats");
+	if (sig_len < static_cast<arma::uword>(config_.win_len)) {
+		return config_.layout == FeatureLayout::frame_major ? mat_type(feat_num_, 0) : mat_type(0, feat_num_);
+	}
+	auto win_num = (sig_len - config_.win_len) / config_.win_shift + 1;
+	auto block = static_cast<arma::uword>(std::max(1, config_.block_frames));
+	auto block_num = (win_num + block - 1) / block;
+
+	auto for_each_block = [&](const std::function<void(arma::uword, arma::uword, Workspace&)>& fn) {
+		auto body = [&](std::size_t b, int slot) {
+			arma::uword first = b * block;
+			fn(first, std::min(block, win_num - first), ws[slot]);
+		};
+		if (pool) {
+			pool->parallel_for(block_num, body);
+		}
+		else {
+			for (arma::uword b = 0; b < block_num; ++b) {
+				body(b, 0);
+			}
+		}
+	};
 
-		// sane fixes
-		mfcc(arma::find_nonfinite(mfcc)).fill(0);
+	// The per-utterance reductions are done per block and then combined in block order,
+	// which keeps the result independent of the number of threads.
+	const bool cmn = config_.cmn;
+	const bool enormalise = config_.feat_energy && config_.enormalise && !config_.ceps_energy;
+	// the static features are gathered as melspec, mfcc, energy; CMN covers all but a log energy
+	const arma::uword energy_row = feat_num_ - 1;
+	const arma::uword cmn_rows = feat_num_ - ((config_.feat_energy && !config_.ceps_energy) ? 1 : 0);
+
+	// feature r of frame w is at ret.memptr() + r * feat_step + w * frame_step
+	const bool frame_major = config_.layout == FeatureLayout::frame_major;
+	mat_type ret = frame_major ? mat_type(feat_num_, win_num) : mat_type(win_num, feat_num_);
+	STAGE_ALLOCATIONS(1);
+	const arma::uword feat_step = frame_major ? 1 : win_num;
+	const arma::uword frame_step = frame_major ? feat_num_ : 1;
+
+	mat_type block_sums(cmn ? cmn_rows : 0, block_num);
+	rowvec_type block_max(enormalise ? block_num : 0);
+
+	for_each_block([&](arma::uword first, arma::uword count, Workspace& ws) {
+		compute_block(signal, first, count, ret, ws);
+
+		STAGE_TIMER(cmn, count);
+		if (cmn) {
+			eT* sum = block_sums.colptr(first / block);
+			for (arma::uword r = 0; r < cmn_rows; ++r) {
+				sum[r] = 0;
+			}
+			for (arma::uword w = first; w < first + count; ++w) {
+				const eT* x = ret.memptr() + w * frame_step;
+				for (arma::uword r = 0; r < cmn_rows; ++r) {
+					sum[r] += x[r * feat_step];
+				}
+			}
+		}
+		if (enormalise) {
+			const eT* x = ret.memptr() + energy_row * feat_step;
+			eT m = x[first * frame_step];
+			for (arma::uword w = first + 1; w < first + count; ++w) {
+				m = std::max(m, x[w * frame_step]);
+			}
+			block_max(first / block) = m;
+		}
+	});
 
-		if (config_.feat_mfcc) {
-			featwin.push_back(mfcc);
+	if (!cmn && !enormalise) {
+		return ret;
+	}
+
+	vec_type mean;
+	if (cmn) {
+		mean.zeros(cmn_rows);
+		for (arma::uword b = 0; b < block_num; ++b) {
+			mean += block_sums.col(b);
 		}
+		mean /= static_cast<eT>(win_num);
+	}
 
-		// energy
-		if (config_.feat_energy) {
-			if (config_.ceps_energy) {
-				energy = arma::sum(melspec) * mfnorm_;
+	eT max = 0, min = 0;
+	if (enormalise) {
+		max = block_max.max();
+		min = max - static_cast<eT>((config_.sil_floor * ::log(10.0)) / 10.0);
+	}
+	const eT escale = static_cast<eT>(config_.escale);
+
+	for_each_block([&](arma::uword first, arma::uword count, Workspace&) {
+		STAGE_TIMER(cmn, 0);
+		for (arma::uword w = first; w < first + count; ++w) {
+			eT* x = ret.memptr() + w * frame_step;
+			if (cmn) {
+				for (arma::uword r = 0; r < cmn_rows; ++r) {
+					x[r * feat_step] -= mean[r];
+				}
 			}
-			else if (!config_.raw_energy) {
-				energy = ::log(arma::sum(arma::square(sig_win)));
+			if (enormalise) {
+				eT& energy = x[energy_row * feat_step];
+				eT e = std::min(std::max(energy, min), max);
+				energy = eT(1) - (max - e) * escale;
 			}
+		}
+	});
 
-			// sane fixes
-			if (arma::arma_isnan(energy) || arma::arma_isinf(energy)) {
-				energy = 0;
-			}
+	return ret;
+}
 
-			featwin.push_back(arma::vec{ energy });
+template<typename eT>
+typename MFCC_HTK_T<eT>::mat_type MFCC_HTK_T<eT>::get_delta(const mat_type& feat, int deltawin)
+{
+	if (deltawin < 1) {
+		throw std::runtime_error("invalid delta window");
+	}
+
+	TraceScope trace("get_delta");
+	STAGE_TIMER(delta, config_.layout == FeatureLayout::frame_major ? feat.n_cols : feat.n_rows);
+	mat_type deltas(feat.n_rows, feat.n_cols);
+	STAGE_ALLOCATIONS(1);
+	if (config_.layout == FeatureLayout::feature_major) {
+		for (arma::uword f = 0; f < feat.n_cols; ++f) {
+			delta_series(feat.colptr(f), feat.n_rows, deltawin, deltas.colptr(f));
 		}
-		
-		feats.push_back(arma::hstack(featwin));
 	}
+	else {
+		std::vector<const eT*> cols(2 * deltawin + 1);
+		for (arma::uword win = 0; win < feat.n_cols; ++win) {
+			delta_at(feat.memptr(), feat.n_rows, feat.n_rows, feat.n_cols, win, deltawin, cols.data(),
+				deltas.colptr(win));
+		}
+	}
+
+	return deltas;
+}
 
-	auto ret = arma::asarray(feats);
+template<typename eT>
+typename MFCC_HTK_T<eT>::mat_type MFCC_HTK_T<eT>::append_deltas(const mat_type& feat, int deltawin, int order)
+{
+	if (deltawin < 1 || order < 0) {
+		throw std::runtime_error("invalid delta window or order");
+	}
 
-	if (config_.cmn) {
-		int with_ceps_energy = (config_.ceps_energy) ? 0 : -1;
-		arma::mat mean = arma::mean(ret(arma::span(0, config_.mfcc_num + with_ceps_energy), arma::span::all), 1);
-		for (int i = 0; i < ret.n_cols; ++i) {
-			ret(arma::span(0, config_.mfcc_num + with_ceps_energy),i) -= mean;
+	TraceScope trace("append_deltas");
+	STAGE_TIMER(delta, config_.layout == FeatureLayout::frame_major ? feat.n_cols : feat.n_rows);
+	STAGE_ALLOCATIONS(1);
+	const arma::uword levels = order + 1;
+
+	if (config_.layout == FeatureLayout::feature_major) {
+		// every feature is contiguous over the frames, so each chain of differences is a
+		// sweep along one column that is still in cache from the order below
+		const arma::uword win_num = feat.n_rows;
+		const arma::uword n = feat.n_cols;
+		mat_type out(win_num, levels * n);
+		for (arma::uword f = 0; f < n; ++f) {
+			std::copy(feat.colptr(f), feat.colptr(f) + win_num, out.colptr(f));
+			for (arma::uword l = 1; l < levels; ++l) {
+				delta_series(out.colptr((l - 1) * n + f), win_num, deltawin, out.colptr(l * n + f));
+			}
 		}
+		return out;
 	}
 
-	if (config_.feat_energy && config_.enormalise && !config_.ceps_energy) {
-		auto max = arma::max(ret(config_.mfcc_num, arma::span::all));
-		auto min = max - (config_.sil_floor * ::log(10.0)) / 10.0;
-		ret(config_.mfcc_num, arma::span::all) = arma::clamp(ret(config_.mfcc_num, arma::span::all), min, max);
-		ret(config_.mfcc_num, arma::span::all) = 1.0 - (max - ret(config_.mfcc_num, arma::span::all)) * config_.escale;
+	// One sweep over the frames. Step s copies the statics of frame s and computes order l of
+	// frame s - l * deltawin, whose window ends at the frame of order l - 1 written just before.
+	// Only the last (order + 1) * deltawin frames are touched at any time.
+	const arma::uword n = feat.n_rows;
+	const arma::uword win_num = feat.n_cols;
+	const arma::uword stride = levels * n;
+	mat_type out(stride, win_num);
+	std::vector<const eT*> cols(2 * deltawin + 1);
+	const arma::uword lag = deltawin;
+	for (arma::uword s = 0; s < win_num + order * lag; ++s) {
+		if (s < win_num) {
+			std::copy(feat.colptr(s), feat.colptr(s) + n, out.colptr(s));
+		}
+		for (arma::uword l = 1; l < levels; ++l) {
+			if (s < l * lag) {
+				break;
+			}
+			const arma::uword t = s - l * lag;
+			if (t < win_num) {
+				delta_at(out.memptr() + (l - 1) * n, stride, n, win_num, t, deltawin, cols.data(),
+					out.colptr(t) + l * n);
+			}
+		}
 	}
+	return out;
+}
 
-	return ret;
+template<typename eT>
+void MFCC_HTK_T<eT>::delta_at(const eT* src, arma::uword stride, arma::uword n, arma::uword win_num,
+	arma::uword t, int deltawin, const eT** c, eT* out)
+{
+	// the frames beyond either end are replicated from the first and the last frame
+	const arma::sword last = static_cast<arma::sword>(win_num) - 1;
+	const arma::sword tt = static_cast<arma::sword>(t);
+	if (tt >= deltawin && tt + deltawin <= last) {
+		for (int j = -deltawin; j <= deltawin; ++j) {
+			c[deltawin + j] = src + (tt + j) * stride;
+		}
+	}
+	else {
+		for (int j = -deltawin; j <= deltawin; ++j) {
+			arma::sword f = std::max<arma::sword>(0, std::min<arma::sword>(tt + j, last));
+			c[deltawin + j] = src + f * stride;
+		}
+	}
+
+	delta_frame(c, n, deltawin, out);
 }
 
-arma::mat MFCC_HTK::get_delta(arma::mat feat, int deltawin)
+template<typename eT>
+void MFCC_HTK_T<eT>::delta_series(const eT* x, arma::uword win_num, int deltawin, eT* out)
 {
-	std::vector<arma::vec> deltas;
+	if (win_num == 0) {
+		return;
+	}
 
-	double norm = 2.0*arma::sum(arma::square(arma::arange(1, deltawin + 1)));
-	auto win_num = feat.n_cols;
-	auto win_len = feat.n_rows;
+	// same operations as delta_frame, along a single feature
+	const eT norm = static_cast<eT>(2.0*arma::sum(arma::square(arma::arange(1, deltawin + 1))));
+	const arma::sword last = static_cast<arma::sword>(win_num) - 1;
+	auto edge = [&](arma::sword win) {
+		eT d = 0;
+		for (int t = 1; t < deltawin + 1; ++t) {
+			const eT tp = x[std::min(win + t, last)];
+			const eT tm = x[std::max<arma::sword>(win - t, 0)];
+			d += ((tp - tm) * static_cast<eT>(t)) / norm;
+		}
+		out[win] = d;
+	};
 
-	for (auto win = 0u; win < win_num; ++win)
+	const arma::sword head = std::min<arma::sword>(deltawin, last + 1);
+	const arma::sword tail = std::max<arma::sword>(head, last + 1 - deltawin);
+	for (arma::sword win = 0; win < head; ++win) {
+		edge(win);
+	}
+	for (arma::sword win = head; win < tail; ++win) {
+		eT d = 0;
+		for (int t = 1; t < deltawin + 1; ++t) {
+			d += ((x[win + t] - x[win - t]) * static_cast<eT>(t)) / norm;
+		}
+		out[win] = d;
+	}
+	for (arma::sword win = tail; win <= last; ++win) {
+		edge(win);
+	}
+}
+
+template<typename eT>
+void MFCC_HTK_T<eT>::delta_frame(const eT* const* cols, arma::uword n, int deltawin, eT* out)
+{
+	const eT norm = static_cast<eT>(2.0*arma::sum(arma::square(arma::arange(1, deltawin + 1))));
+	const eT* const* mid = cols + deltawin;
+
+	for (arma::uword i = 0; i < n; ++i) {
+		out[i] = 0;
+	}
+	for (int t = 1; t < deltawin + 1; ++t) {
+		const eT* tp = mid[t];
+		const eT* tm = mid[-t];
+		const eT k = static_cast<eT>(t);
+		for (arma::uword i = 0; i < n; ++i) {
+			out[i] += ((tp[i] - tm[i]) * k) / norm;
+		}
+	}
+}
+
+template<typename eT>
+template<typename S>
+void MFCC_HTK_T<eT>::compute_block(const S* signal, arma::uword first, arma::uword count, mat_type& out, Workspace& ws) const
+{
+	const arma::uword win_len = config_.win_len;
+
+	// frame the block, one window per column, converting the samples to eT
+	mat_type& frames = ws.frames;
 	{
-		arma::vec delta = arma::zeros(win_len);
+		STAGE_TIMER(convert, count);
+		STAGE_WATCH(eT, &frames);
+		frames.set_size(win_len, count);
+		for (arma::uword w = 0; w < count; ++w) {
+			const S* src = signal + (first + w) * config_.win_shift;
+			eT* dst = frames.colptr(w);
+			for (arma::uword i = 0; i < win_len; ++i) {
+				dst[i] = static_cast<eT>(src[i]);
+			}
+		}
+	}
 
-		for (int t = 1; t < deltawin + 1; ++t)
-		{
-			int tm = win - t;
-			if (tm < 0)
-				tm = 0;
+	process_frames(frames, first, out, ws, config_.layout);
+}
+
+template<typename eT>
+void MFCC_HTK_T<eT>::process_frames(mat_type& frames, arma::uword first, mat_type& out, Workspace& ws,
+	FeatureLayout layout) const
+{
+	const arma::uword win_len = frames.n_rows;
+	const arma::uword count = frames.n_cols;
+	const eT preemph = config_.preemph;
+
+	// raw energy is calculated before any windowing or pre-emphasis
+	STAGE_TIMER(energy, count);
+	STAGE_WATCH(eT, &ws.energy, &ws.spec, &ws.melspec, &ws.mfcc);
+	rowvec_type& energy = ws.energy;
+	if (config_.feat_energy && !config_.ceps_energy && config_.raw_energy) {
+		energy = arma::log(arma::sum(arma::square(frames)));
+	}
+
+	// preemphasis
+	STAGE_LAP(preemphasis);
+	for (arma::uword w = 0; w < count; ++w) {
+		eT* x = frames.colptr(w);
+		for (arma::uword i = win_len - 1; i > 0; --i) {
+			x[i] -= x[i - 1] * preemph;
+		}
+		x[0] -= x[0] * preemph;
+	}
+
+	// windowing
+	STAGE_LAP(window);
+	frames.each_col() %= hamm_;
 
-			int tp = win + t;
-			if (tp >= win_num)
-				tp = win_num - 1;
+	// energy of the windowed signal
+	STAGE_LAP(energy);
+	if (config_.feat_energy && !config_.ceps_energy && !config_.raw_energy) {
+		energy = arma::log(arma::sum(arma::square(frames)));
+	}
+
+	// fft
+	STAGE_LAP(fft);
+	mat_type& spec = ws.spec;
+	spec.set_size(fft_len_ / 2, count);
+	STAGE_ALLOCATIONS(ws.fft_work.capacity() < static_cast<std::size_t>(fft_.work_size()) ? 1 : 0);
+	ws.fft_work.resize(fft_.work_size());
+	for (arma::uword w = 0; w < count; ++w) {
+		fft_.magnitude(frames.colptr(w), win_len, spec.colptr(w), ws.fft_work.data());
+	}
 
-			delta += (t*(feat.col(tp) - feat.col(tm))) / norm;
+	// filters
+	STAGE_LAP(filterbank);
+	mat_type& melspec = ws.melspec;
+	if (!filter_chan_.is_empty()) {
+		melspec.zeros(filter_mat_.n_cols, count);
+		const arma::uword bins = filter_chan_.n_elem;
+		const arma::uword* chan = filter_chan_.memptr();
+		const eT* lo = filter_lo_wt_.memptr();
+		const eT* hi = filter_hi_wt_.memptr();
+		for (arma::uword w = 0; w < count; ++w) {
+			const eT* x = spec.colptr(w) + filter_first_bin_;
+			eT* y = melspec.colptr(w);
+			for (arma::uword k = 0; k < bins; ++k) {
+				y[chan[k]] += lo[k] * x[k];
+				y[chan[k] + 1] += hi[k] * x[k];
+			}
 		}
+	}
+	else {
+		melspec = filter_mat_.t() * spec;
+	}
 
-		deltas.push_back(delta);		
+	// floor (before log) and log
+	STAGE_LAP(log);
+	melspec.transform([](eT x) { return std::log(std::max(x, eT(0.001))); });
+
+	// dct
+	STAGE_LAP(dct);
+	mat_type& mfcc = ws.mfcc;
+	mfcc = dct_base_.t() * melspec;
+	mfcc *= mfnorm_;
+
+	// lifter
+	STAGE_LAP(lifter);
+	mfcc.each_col() %= lifter_;
+
+	// sane fixes
+	mfcc.transform([](eT x) { return std::isfinite(x) ? x : eT(0); });
+
+	// energy
+	STAGE_LAP(energy);
+	if (config_.feat_energy && config_.ceps_energy) {
+		energy = arma::sum(melspec) * mfnorm_;
 	}
 
-	return arma::asarray(deltas);
+	// sane fixes
+	energy.transform([](eT x) { return std::isfinite(x) ? x : eT(0); });
+
+	// gather the chosen features
+	STAGE_LAP(gather);
+	arma::uword row = 0;
+	auto frames_span = arma::span(first, first + count - 1);
+	auto put = [&](const mat_type& feats) {
+		auto feats_span = arma::span(row, row + feats.n_rows - 1);
+		if (layout == FeatureLayout::frame_major) {
+			out(feats_span, frames_span) = feats;
+		}
+		else {
+			out(frames_span, feats_span) = feats.t();
+		}
+		row += feats.n_rows;
+	};
+	if (config_.feat_melspec) {
+		put(melspec);
+	}
+	if (config_.feat_mfcc) {
+		put(mfcc);
+	}
+	if (config_.feat_energy) {
+		put(energy);
+	}
 }
 
-void MFCC_HTK::create_filter_htk()
+template<typename eT>
+void MFCC_HTK_T<eT>::create_filter_htk()
 {
 	long sampPeriod = 10000000 / config_.samp_freq;
 	auto reader = gen_filter(config_.filter_num, config_.win_len, sampPeriod,
@@ -196,7 +588,7 @@ void MFCC_HTK::create_filter_htk()
 	}
 
 	config_.filter_num = filter_num;
-	filter_mat_ = arma::zeros(fft_len_ / 2, config_.filter_num);
+	filter_mat_ = arma::zeros<mat_type>(fft_len_ / 2, config_.filter_num);
 	for (auto i = 0u; i < reader.size(); ++i) {
 		auto wt = std::get<0>(reader[i]);
 		auto bin = static_cast<int>(std::get<1>(reader[i]));
@@ -210,9 +602,10 @@ void MFCC_HTK::create_filter_htk()
 	}
 }
 
-void MFCC_HTK::create_filter()
+template<typename eT>
+void MFCC_HTK_T<eT>::create_filter()
 {
-	filter_mat_ = arma::zeros(fft_len_ / 2, config_.filter_num);
+	arma::mat filter_mat = arma::zeros(fft_len_ / 2, config_.filter_num);
 
 	auto mel2freq = [](arma::vec mel) {
 		return arma::vec{ 700.0*(arma::exp((mel) / 1127.0) - 1) };
@@ -235,9 +628,57 @@ void MFCC_HTK::create_filter()
 		auto d1 = point_c[f + 1] - point_c[f];
 		auto d2 = point_c[f + 2] - point_c[f + 1];
 		
-		filter_mat_(arma::span(point_c[f], point_c[f+1]), f) = 
+		filter_mat(arma::span(point_c[f], point_c[f+1]), f) = 
 			arma::linspace(0, 1, d1 + 1);
-		filter_mat_(arma::span(point_c[f+1], point_c[f + 2]), f) = 
+		filter_mat(arma::span(point_c[f+1], point_c[f + 2]), f) = 
 			arma::linspace(1, 0, d2 + 1);
 	}
+
+	filter_mat_ = arma::conv_to<mat_type>::from(filter_mat);
+}
+
+template<typename eT>
+void MFCC_HTK_T<eT>::create_sparse_filter()
+{
+	filter_first_bin_ = 0;
+	filter_chan_.reset();
+	filter_lo_wt_.reset();
+	filter_hi_wt_.reset();
+
+	const arma::uword chans = filter_mat_.n_cols;
+	arma::uvec used = arma::find(arma::any(filter_mat_ != eT(0), 1));
+	if (chans < 2 || used.is_empty()) {
+		return;
+	}
+
+	const arma::uword first = used.min();
+	const arma::uword bins = used.max() - first + 1;
+	arma::uvec chan(bins, arma::fill::zeros);
+	vec_type lo(bins, arma::fill::zeros);
+	vec_type hi(bins, arma::fill::zeros);
+
+	for (arma::uword k = 0; k < bins; ++k) {
+		arma::uvec nz = arma::find(filter_mat_.row(first + k));
+		if (nz.is_empty()) {
+			continue;
+		}
+		// more than two channels, or two channels that are not neighbours
+		if (nz.n_elem > 2 || nz(nz.n_elem - 1) - nz(0) > 1) {
+			return;
+		}
+
+		// keep the upper channel in range when the lower one is the last channel
+		arma::uword c = std::min(nz(0), chans - 2);
+		chan(k) = c;
+		lo(k) = filter_mat_(first + k, c);
+		hi(k) = filter_mat_(first + k, c + 1);
+	}
+
+	filter_first_bin_ = first;
+	filter_chan_ = chan;
+	filter_lo_wt_ = lo;
+	filter_hi_wt_ = hi;
 }
+
+template class MFCC_HTK_T<double>;
+template class MFCC_HTK_T<float>;
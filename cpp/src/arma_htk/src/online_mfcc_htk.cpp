@@ -0,0 +1,194 @@
+#include "online_mfcc_htk.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+	/// <summary>	The configuration computing one frame at a time. </summary>
+	MFCC_HTK_Config frame_by_frame(MFCC_HTK_Config config)
+	{
+		config.block_frames = 1;
+		return config;
+	}
+}
+
+template<typename eT>
+OnlineMFCC_HTK_T<eT>::OnlineMFCC_HTK_T(const Config& config, int deltawin, int order)
+	: mfcc_(frame_by_frame(config)), deltawin_(deltawin), order_(order)
+{
+	if (config.cmn || (config.feat_energy && config.enormalise && !config.ceps_energy)) {
+		throw std::runtime_error("cmn and enormalise need the whole utterance");
+	}
+	if (deltawin_ < 1 || order_ < 0) {
+		throw std::runtime_error("invalid delta window or order");
+	}
+
+	// the ring holds the window of the next frame
+	ring_.set_size(mfcc_.config().win_len);
+
+	// enough history for the deltas of the highest order and the statics of its output frame
+	const arma::uword history = (order_ + 1) * deltawin_ + 1;
+	levels_.assign(order_ + 1, mat_type(mfcc_.feat_num(), history));
+
+	reset();
+}
+
+template<typename eT>
+void OnlineMFCC_HTK_T<eT>::reset()
+{
+	ring_head_ = 0;
+	ring_size_ = 0;
+	skip_ = 0;
+	done_.assign(order_ + 1, 0);
+	emitted_ = 0;
+}
+
+template<typename eT>
+typename OnlineMFCC_HTK_T<eT>::mat_type OnlineMFCC_HTK_T<eT>::push(const eT* samples, arma::uword n)
+{
+	std::vector<eT> out;
+	const Config& c = mfcc_.config();
+	const arma::uword win_len = c.win_len;
+	const arma::uword cap = ring_.n_elem;
+
+	while (n > 0) {
+		if (skip_ > 0) {
+			arma::uword m = std::min(skip_, n);
+			samples += m;
+			n -= m;
+			skip_ -= m;
+			continue;
+		}
+
+		arma::uword m = std::min(cap - ring_size_, n);
+		arma::uword tail = (ring_head_ + ring_size_) % cap;
+		arma::uword first = std::min(m, cap - tail);
+		std::copy(samples, samples + first, ring_.memptr() + tail);
+		std::copy(samples + first, samples + m, ring_.memptr());
+		ring_size_ += m;
+		samples += m;
+		n -= m;
+
+		if (ring_size_ >= win_len && (ring_size_ == cap || n == 0)) {
+			process_block((ring_size_ - win_len) / c.win_shift + 1, out);
+		}
+	}
+
+	return gather(out);
+}
+
+template<typename eT>
+typename OnlineMFCC_HTK_T<eT>::mat_type OnlineMFCC_HTK_T<eT>::flush()
+{
+	std::vector<eT> out;
+	const Config& c = mfcc_.config();
+	const arma::uword win_len = c.win_len;
+
+	if (ring_size_ >= win_len) {
+		process_block((ring_size_ - win_len) / c.win_shift + 1, out);
+	}
+	cascade(true, out);
+
+	mat_type ret = gather(out);
+	reset();
+	return ret;
+}
+
+template<typename eT>
+void OnlineMFCC_HTK_T<eT>::process_block(arma::uword count, std::vector<eT>& out)
+{
+	const Config& c = mfcc_.config();
+	const arma::uword win_len = c.win_len;
+	const arma::uword shift = c.win_shift;
+	const arma::uword cap = ring_.n_elem;
+
+	// frame the block from the ring buffer, one window per column
+	mat_type& frames = ws_.frames;
+	frames.set_size(win_len, count);
+	for (arma::uword w = 0; w < count; ++w) {
+		arma::uword s = (ring_head_ + w * shift) % cap;
+		arma::uword first = std::min(win_len, cap - s);
+		eT* dst = frames.colptr(w);
+		std::copy(ring_.memptr() + s, ring_.memptr() + s + first, dst);
+		std::copy(ring_.memptr(), ring_.memptr() + (win_len - first), dst + first);
+	}
+
+	mat_type feats(mfcc_.feat_num(), count);
+	mfcc_.process_frames(frames, 0, feats, ws_, FeatureLayout::frame_major);
+
+	mat_type& statics = levels_[0];
+	for (arma::uword w = 0; w < count; ++w) {
+		statics.col(done_[0] % statics.n_cols) = feats.col(w);
+		++done_[0];
+		cascade(false, out);
+	}
+
+	// drop the samples that no later frame uses
+	arma::uword drop = count * shift;
+	if (drop <= ring_size_) {
+		ring_head_ = (ring_head_ + drop) % cap;
+		ring_size_ -= drop;
+	}
+	else {
+		skip_ += drop - ring_size_;
+		ring_head_ = 0;
+		ring_size_ = 0;
+	}
+}
+
+template<typename eT>
+void OnlineMFCC_HTK_T<eT>::cascade(bool final, std::vector<eT>& out)
+{
+	const arma::uword n = mfcc_.feat_num();
+	std::vector<const eT*> cols(2 * deltawin_ + 1);
+
+	for (int l = 1; l <= order_; ++l) {
+		const mat_type& src = levels_[l - 1];
+		mat_type& dst = levels_[l];
+		const arma::uword avail = done_[l - 1];
+		const arma::uword hist = src.n_cols;
+
+		while (done_[l] < avail) {
+			const arma::uword t = done_[l];
+			// without the end of the utterance, frame t + deltawin must be known
+			if (!final && t + deltawin_ >= avail) {
+				break;
+			}
+
+			for (int j = -deltawin_; j <= deltawin_; ++j) {
+				arma::sword f = static_cast<arma::sword>(t) + j;
+				f = std::max<arma::sword>(0, std::min<arma::sword>(f, avail - 1));
+				cols[deltawin_ + j] = src.colptr(f % hist);
+			}
+
+			MFCC_HTK_T<eT>::delta_frame(cols.data(), n, deltawin_, dst.colptr(t % hist));
+			++done_[l];
+		}
+	}
+
+	while (emitted_ < done_[order_]) {
+		for (int l = 0; l <= order_; ++l) {
+			const eT* col = levels_[l].colptr(emitted_ % levels_[l].n_cols);
+			out.insert(out.end(), col, col + n);
+		}
+		++emitted_;
+	}
+}
+
+template<typename eT>
+typename OnlineMFCC_HTK_T<eT>::mat_type OnlineMFCC_HTK_T<eT>::gather(const std::vector<eT>& out) const
+{
+	const arma::uword rows = feat_num();
+	const bool frame_major = mfcc_.config().layout == FeatureLayout::frame_major;
+	if (out.empty()) {
+		return frame_major ? mat_type(rows, 0) : mat_type(0, rows);
+	}
+	mat_type ret(out.data(), rows, out.size() / rows);
+	if (!frame_major) {
+		arma::inplace_trans(ret);
+	}
+	return ret;
+}
+
+template class OnlineMFCC_HTK_T<double>;
+template class OnlineMFCC_HTK_T<float>;
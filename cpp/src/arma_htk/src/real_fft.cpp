@@ -0,0 +1,128 @@
+#include "real_fft.h"
+#include <cmath>
+#include <stdexcept>
+
+// Plain complex product. std::complex operator* also handles the inf/nan corner
+// cases of Annex G, which makes it an out-of-line call in the butterflies.
+template<typename eT>
+static inline std::complex<eT> cmul(const std::complex<eT>& a, const std::complex<eT>& b)
+{
+	return std::complex<eT>(a.real()*b.real() - a.imag()*b.imag(),
+		a.real()*b.imag() + a.imag()*b.real());
+}
+
+template<typename eT>
+RealFFT<eT>::RealFFT(int n)
+	: n_(n)
+{
+	if (n < 2 || (n & (n - 1)) != 0) {
+		throw std::invalid_argument("RealFFT: length must be a power of two");
+	}
+
+	const int m = n / 2;
+	const double pi = 3.14159265358979323846;
+
+	bitrev_.resize(m);
+	int bits = 0;
+	while ((1 << bits) < m) ++bits;
+	for (int i = 0; i < m; ++i) {
+		int r = 0;
+		for (int b = 0; b < bits; ++b) {
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		bitrev_[i] = r;
+	}
+
+	twiddle_.resize(m / 2 + 1);
+	for (int k = 0; k < (int)twiddle_.size(); ++k) {
+		double a = -2.0 * pi * k / m;
+		twiddle_[k] = cx_type(static_cast<eT>(std::cos(a)), static_cast<eT>(std::sin(a)));
+	}
+
+	post_.resize(m / 2 + 1);
+	for (int k = 0; k < (int)post_.size(); ++k) {
+		double a = -2.0 * pi * k / n;
+		post_[k] = cx_type(static_cast<eT>(std::cos(a)), static_cast<eT>(std::sin(a)));
+	}
+}
+
+template<typename eT>
+void RealFFT<eT>::complex_fft(cx_type* z) const
+{
+	const int m = n_ / 2;
+
+	for (int i = 0; i < m; ++i) {
+		int r = bitrev_[i];
+		if (r > i) {
+			std::swap(z[i], z[r]);
+		}
+	}
+
+	for (int size = 2; size <= m; size *= 2) {
+		const int half = size / 2;
+		const int step = m / size;
+		for (int start = 0; start < m; start += size) {
+			cx_type* lo = z + start;
+			cx_type* hi = lo + half;
+			for (int j = 0; j < half; ++j) {
+				cx_type t = cmul(twiddle_[j * step], hi[j]);
+				hi[j] = lo[j] - t;
+				lo[j] += t;
+			}
+		}
+	}
+}
+
+template<typename eT>
+void RealFFT<eT>::forward(const eT* in, int len, cx_type* out) const
+{
+	const int m = n_ / 2;
+	if (len > n_) {
+		len = n_;
+	}
+
+	// pack even samples into the real part and odd samples into the imaginary part
+	const int full = len / 2;
+	for (int j = 0; j < full; ++j) {
+		out[j] = cx_type(in[2 * j], in[2 * j + 1]);
+	}
+	int j = full;
+	if (len % 2 != 0) {
+		out[j++] = cx_type(in[len - 1], eT(0));
+	}
+	for (; j < m; ++j) {
+		out[j] = cx_type(eT(0), eT(0));
+	}
+
+	complex_fft(out);
+
+	// separate the spectra of the even and odd samples:
+	// X[k] = E[k] + exp(-2 pi i k / N) O[k]
+	const cx_type z0 = out[0];
+	out[0] = cx_type(z0.real() + z0.imag(), eT(0));
+	out[m] = cx_type(z0.real() - z0.imag(), eT(0));
+
+	for (int k = 1; k <= m / 2; ++k) {
+		const cx_type a = out[k];
+		const cx_type b = std::conj(out[m - k]);
+		const cx_type e = eT(0.5) * (a + b);
+		const cx_type d = a - b;
+		const cx_type o(eT(0.5) * d.imag(), -eT(0.5) * d.real());
+		const cx_type wo = cmul(post_[k], o);
+		out[k] = e + wo;
+		out[m - k] = std::conj(e - wo);
+	}
+}
+
+template<typename eT>
+void RealFFT<eT>::magnitude(const eT* in, int len, eT* out, cx_type* work) const
+{
+	forward(in, len, work);
+	const int m = n_ / 2;
+	for (int k = 0; k < m; ++k) {
+		out[k] = std::sqrt(work[k].real()*work[k].real() + work[k].imag()*work[k].imag());
+	}
+}
+
+template class RealFFT<double>;
+template class RealFFT<float>;
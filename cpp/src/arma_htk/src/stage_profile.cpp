@@ -0,0 +1,169 @@
+#include "stage_profile.h"
+#include "stage_timer.h"
+
+#ifdef ARMA_HTK_PROFILE
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace {
+
+	const char* const stage_names[profile_stage_count] = {
+		"convert", "preemphasis", "window", "fft", "filterbank", "log", "dct", "lifter", "energy", "gather", "cmn",
+		"delta", "htk_load", "htk_save"
+	};
+
+#ifdef ARMA_HTK_PROFILE
+
+	/// <summary>	The accumulators of the running threads and the counts of the threads that exited. </summary>
+	struct Registry {
+		std::mutex mutex;
+		std::vector<ThreadCounters*> threads;
+		uint64_t exited[ThreadCounters::size] = {};
+	};
+
+	/// <summary>	Never destroyed, threads may exit after the static destructors ran. </summary>
+	Registry& registry()
+	{
+		static Registry* r = new Registry();
+		return *r;
+	}
+
+	std::atomic<AllocationCounter> allocation_counter(nullptr);
+
+	/// <summary>	Registers the accumulators of a thread and keeps their counts when it exits. </summary>
+	struct ThreadSlot {
+		ThreadCounters counters;
+
+		ThreadSlot()
+		{
+			for (auto& v : counters.values) {
+				v.store(0, std::memory_order_relaxed);
+			}
+			Registry& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.threads.push_back(&counters);
+		}
+
+		~ThreadSlot()
+		{
+			Registry& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			for (int i = 0; i < ThreadCounters::size; ++i) {
+				r.exited[i] += counters.values[i].load(std::memory_order_relaxed);
+			}
+			r.threads.erase(std::find(r.threads.begin(), r.threads.end(), &counters));
+		}
+	};
+
+#endif
+}
+
+const char* profile_stage_name(ProfileStage stage)
+{
+	const int i = static_cast<int>(stage);
+	return i >= 0 && i < profile_stage_count ? stage_names[i] : "unknown";
+}
+
+StageProfile StageProfile::since(const StageProfile& earlier) const
+{
+	StageProfile d;
+	for (int s = 0; s < profile_stage_count; ++s) {
+		d.stages[s].ns = stages[s].ns - earlier.stages[s].ns;
+		d.stages[s].cycles = stages[s].cycles - earlier.stages[s].cycles;
+		d.stages[s].calls = stages[s].calls - earlier.stages[s].calls;
+		d.stages[s].frames = stages[s].frames - earlier.stages[s].frames;
+		d.stages[s].allocations = stages[s].allocations - earlier.stages[s].allocations;
+	}
+	d.bytes_read = bytes_read - earlier.bytes_read;
+	d.allocations = allocations - earlier.allocations;
+	return d;
+}
+
+#ifdef ARMA_HTK_PROFILE
+
+ThreadCounters& thread_counters()
+{
+	thread_local ThreadSlot slot;
+	return slot.counters;
+}
+
+uint64_t thread_allocation_count()
+{
+	const AllocationCounter counter = allocation_counter.load(std::memory_order_relaxed);
+	return counter ? counter() : 0;
+}
+
+bool stage_profile_enabled()
+{
+	return true;
+}
+
+StageProfile stage_profile()
+{
+	uint64_t sum[ThreadCounters::size];
+	{
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		std::copy(r.exited, r.exited + ThreadCounters::size, sum);
+		for (const ThreadCounters* t : r.threads) {
+			for (int i = 0; i < ThreadCounters::size; ++i) {
+				sum[i] += t->values[i].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	StageProfile p;
+	for (int s = 0; s < profile_stage_count; ++s) {
+		const uint64_t* c = sum + ThreadCounters::per_stage * s;
+		p.stages[s].ns = c[0];
+		p.stages[s].cycles = c[1];
+		p.stages[s].calls = c[2];
+		p.stages[s].frames = c[3];
+		p.stages[s].allocations = c[4];
+	}
+	p.bytes_read = sum[ThreadCounters::bytes_read];
+	p.allocations = sum[ThreadCounters::allocations];
+	return p;
+}
+
+void set_allocation_counter(AllocationCounter counter)
+{
+	allocation_counter.store(counter, std::memory_order_relaxed);
+}
+
+void reset_stage_profile()
+{
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	std::fill(r.exited, r.exited + ThreadCounters::size, 0);
+	for (ThreadCounters* t : r.threads) {
+		for (auto& v : t->values) {
+			v.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+#else
+
+bool stage_profile_enabled()
+{
+	return false;
+}
+
+StageProfile stage_profile()
+{
+	return StageProfile();
+}
+
+void set_allocation_counter(AllocationCounter)
+{
+}
+
+void reset_stage_profile()
+{
+}
+
+#endif
@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	stage_timer.h
+//
+// summary:	Declares the macros instrumenting the library, empty without ARMA_HTK_PROFILE
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "stage_profile.h"
+
+#ifdef ARMA_HTK_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <initializer_list>
+#include <armadillo>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ARMA_HTK_RDTSC() __rdtsc()
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define ARMA_HTK_RDTSC() __rdtsc()
+#else
+#define ARMA_HTK_RDTSC() 0
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	The accumulators of one thread. </summary>
+/// <details>
+/// Only the owning thread adds to them, so an add is a relaxed load and store without a locked
+/// instruction. The atomics only make the reads of stage_profile() from other threads safe.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct ThreadCounters {
+
+	/// <summary>	ns, cycles, calls, frames and allocations of every stage, then bytes read and allocations. </summary>
+	static const int per_stage = 5;
+	static const int size = per_stage * profile_stage_count + 2;
+	static const int bytes_read = per_stage * profile_stage_count;
+	static const int allocations = bytes_read + 1;
+
+	std::atomic<uint64_t> values[size];
+
+	void add(int i, uint64_t n)
+	{
+		values[i].store(values[i].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+};
+
+/// <summary>	The accumulators of the calling thread, registered on first use. </summary>
+ThreadCounters& thread_counters();
+
+/// <summary>	The count of the allocation counter for the calling thread, 0 without one. </summary>
+uint64_t thread_allocation_count();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Charges the time between two laps to the stage that was running. </summary>
+/// <details>
+/// Stages that follow each other only need one clock reading between them. The last stage
+/// is charged when the timer goes out of scope. A stage entered several times, like the energy,
+/// counts one call and its frames once. The allocations of the allocation counter are charged
+/// to the stages the same way as the time.
+/// </details>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class StageTimer
+{
+public:
+
+	typedef std::chrono::steady_clock clock;
+
+	StageTimer(ProfileStage stage, uint64_t frames)
+		: counters_(thread_counters()), stage_(stage), frames_(frames), charged_(0),
+		allocations_(thread_allocation_count()), start_(clock::now()), cycles_(ARMA_HTK_RDTSC()) {}
+
+	~StageTimer() { lap(stage_); }
+
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+	/// <summary>	Ends the running stage and starts the given one on the same frames. </summary>
+	void lap(ProfileStage stage)
+	{
+		const auto now = clock::now();
+		const uint64_t cycles = ARMA_HTK_RDTSC();
+		const uint64_t allocations = thread_allocation_count();
+		const int i = ThreadCounters::per_stage * static_cast<int>(stage_);
+		counters_.add(i, std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count());
+		counters_.add(i + 1, cycles - cycles_);
+		counters_.add(i + 4, allocations - allocations_);
+		const uint32_t bit = 1u << static_cast<int>(stage_);
+		if (!(charged_ & bit)) {
+			charged_ |= bit;
+			counters_.add(i + 2, 1);
+			counters_.add(i + 3, frames_);
+		}
+		stage_ = stage;
+		allocations_ = allocations;
+		start_ = now;
+		cycles_ = cycles;
+	}
+
+private:
+
+	ThreadCounters& counters_;
+	ProfileStage stage_;
+	uint64_t frames_;
+
+	/// <summary>	The stages whose call and frames were counted. </summary>
+	uint32_t charged_;
+	uint64_t allocations_;
+	clock::time_point start_;
+	uint64_t cycles_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Counts the matrices whose memory changed in its scope, i.e. that were allocated. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+class AllocationWatch
+{
+public:
+
+	AllocationWatch(std::initializer_list<const arma::Mat<eT>*> mats) : n_(0)
+	{
+		for (const arma::Mat<eT>* m : mats) {
+			if (n_ < max_mats) {
+				mats_[n_] = m;
+				mem_[n_++] = m->memptr();
+			}
+		}
+	}
+
+	~AllocationWatch()
+	{
+		uint64_t changed = 0;
+		for (std::size_t i = 0; i < n_; ++i) {
+			changed += mats_[i]->memptr() != mem_[i] && mats_[i]->n_elem > arma::arma_config::mat_prealloc;
+		}
+		if (changed) {
+			thread_counters().add(ThreadCounters::allocations, changed);
+		}
+	}
+
+	AllocationWatch(const AllocationWatch&) = delete;
+	AllocationWatch& operator=(const AllocationWatch&) = delete;
+
+private:
+
+	static const std::size_t max_mats = 8;
+	const arma::Mat<eT>* mats_[max_mats];
+	const eT* mem_[max_mats];
+	std::size_t n_;
+};
+
+#define STAGE_TIMER(stage, frames) StageTimer stage_timer_(ProfileStage::stage, static_cast<uint64_t>(frames))
+#define STAGE_LAP(stage) stage_timer_.lap(ProfileStage::stage)
+#define STAGE_WATCH(eT, ...) AllocationWatch<eT> stage_watch_({ __VA_ARGS__ })
+#define STAGE_ALLOCATIONS(n) thread_counters().add(ThreadCounters::allocations, static_cast<uint64_t>(n))
+#define STAGE_BYTES_READ(n) thread_counters().add(ThreadCounters::bytes_read, static_cast<uint64_t>(n))
+
+#else
+
+#define STAGE_TIMER(stage, frames) ((void)0)
+#define STAGE_LAP(stage) ((void)0)
+#define STAGE_WATCH(eT, ...) ((void)0)
+#define STAGE_ALLOCATIONS(n) ((void)0)
+#define STAGE_BYTES_READ(n) ((void)0)
+
+#endif
@@ -0,0 +1,185 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads)
+	: stop_(false)
+{
+	if (threads <= 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (int i = 1; i < threads; ++i) {
+		workers_.emplace_back(&ThreadPool::worker, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	work_cv_.notify_all();
+	for (auto& t : workers_) {
+		t.join();
+	}
+}
+
+void ThreadPool::parallel_for(std::size_t n, const Body& fn)
+{
+	if (n == 0) {
+		return;
+	}
+	if (workers_.empty() || n == 1) {
+		for (std::size_t i = 0; i < n; ++i) {
+			fn(i, 0);
+		}
+		return;
+	}
+
+	Job job;
+	job.fn = &fn;
+	job.n = n;
+	job.next = 0;
+	job.queues = nullptr;
+	execute(job);
+}
+
+void ThreadPool::parallel_for_stealing(const std::vector<std::size_t>& order, const Body& fn)
+{
+	if (order.empty()) {
+		return;
+	}
+	if (workers_.empty() || order.size() == 1) {
+		for (auto i : order) {
+			fn(i, 0);
+		}
+		return;
+	}
+
+	std::vector<std::unique_ptr<StealQueue>> queues;
+	for (int t = 0; t < size(); ++t) {
+		queues.emplace_back(new StealQueue());
+	}
+	for (std::size_t k = 0; k < order.size(); ++k) {
+		queues[k % queues.size()]->items.push_back(order[k]);
+	}
+
+	Job job;
+	job.fn = &fn;
+	job.n = order.size();
+	job.next = 0;
+	job.queues = &queues;
+	execute(job);
+}
+
+void ThreadPool::execute(Job& job)
+{
+	job.slots = 0;
+	job.done = 0;
+	job.active = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(&job);
+	}
+	work_cv_.notify_all();
+
+	run(job);
+
+	// the job lives on the caller's stack, so wait until no worker refers to it anymore
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = std::find(jobs_.begin(), jobs_.end(), &job);
+	if (it != jobs_.end()) {
+		jobs_.erase(it);
+	}
+	done_cv_.wait(lock, [&] { return job.done == job.n && job.active == 0; });
+
+	if (job.error) {
+		std::rethrow_exception(job.error);
+	}
+}
+
+bool ThreadPool::take(Job& job, int slot, std::size_t& index)
+{
+	if (!job.queues) {
+		index = job.next.fetch_add(1);
+		return index < job.n;
+	}
+
+	auto& queues = *job.queues;
+	{
+		StealQueue& own = *queues[slot];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.items.empty()) {
+			index = own.items.front();
+			own.items.pop_front();
+			return true;
+		}
+	}
+
+	const int count = static_cast<int>(queues.size());
+	for (int k = 1; k < count; ++k) {
+		StealQueue& victim = *queues[(slot + k) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.items.empty()) {
+			index = victim.items.back();
+			victim.items.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::run(Job& job)
+{
+	// A thread only leaves a job once nothing is left to claim, so a late joiner
+	// beyond size() threads would not find any work.
+	const int slot = job.slots.fetch_add(1);
+	if (slot >= size()) {
+		return;
+	}
+
+	std::size_t i;
+	while (take(job, slot, i)) {
+		try {
+			(*job.fn)(i, slot);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!job.error) {
+				job.error = std::current_exception();
+			}
+		}
+
+		if (job.done.fetch_add(1) + 1 == job.n) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			done_cv_.notify_all();
+		}
+	}
+}
+
+void ThreadPool::worker()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+		work_cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+		if (stop_) {
+			return;
+		}
+
+		Job* job = jobs_.front();
+		++job->active;
+		lock.unlock();
+
+		run(*job);
+
+		lock.lock();
+		// every index has been handed out, stop serving this job
+		auto it = std::find(jobs_.begin(), jobs_.end(), job);
+		if (it != jobs_.end()) {
+			jobs_.erase(it);
+		}
+		--job->active;
+		done_cv_.notify_all();
+	}
+}
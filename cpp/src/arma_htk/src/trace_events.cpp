@@ -0,0 +1,189 @@
+#include "trace_events.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> trace_detail::active(false);
+
+namespace {
+
+	struct Event {
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	/// <summary>	The events of one thread in one trace. </summary>
+	/// <details>
+	/// Only the owning thread writes the events, count publishes them to write_trace.
+	/// </details>
+	struct ThreadTrace {
+		ThreadTrace(int tid, std::size_t capacity)
+			: tid(tid), capacity(capacity), events(new Event[capacity]), count(0), dropped(0) {}
+
+		int tid;
+		std::string name;
+		std::size_t capacity;
+		std::unique_ptr<Event[]> events;
+		std::atomic<std::size_t> count;
+		std::atomic<uint64_t> dropped;
+	};
+
+	/// <summary>	The buffers of the current trace. </summary>
+	struct Registry {
+		std::mutex mutex;
+		std::vector<std::shared_ptr<ThreadTrace>> threads;
+		std::size_t capacity = 0;
+		std::atomic<uint64_t> start{ 0 };
+
+		/// <summary>	Incremented by start_trace, so every thread takes a new buffer. </summary>
+		std::atomic<uint32_t> generation{ 0 };
+	};
+
+	/// <summary>	Never destroyed, threads may exit after the static destructors ran. </summary>
+	Registry& registry()
+	{
+		static Registry* r = new Registry();
+		return *r;
+	}
+
+	std::atomic<int> next_tid(1);
+
+	/// <summary>	The buffer of a thread, which keeps it alive while the thread writes to it. </summary>
+	struct ThreadState {
+		int tid = next_tid++;
+		std::string name;
+		uint32_t generation = 0;
+		std::shared_ptr<ThreadTrace> trace;
+	};
+
+	thread_local ThreadState state;
+
+	void write_string(std::ostream& out, const std::string& s)
+	{
+		out << '"';
+		for (char c : s) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) >= 0x20) {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
+	/// <summary>	Nanoseconds as microseconds with three decimals. </summary>
+	std::string micros(uint64_t ns)
+	{
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%.3f", ns / 1000.0);
+		return buf;
+	}
+}
+
+uint64_t trace_detail::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace_detail::record(const char* name, uint64_t begin, uint64_t end)
+{
+	Registry& r = registry();
+	ThreadState& s = state;
+
+	// a scope that began before the trace started is not part of it
+	if (begin < r.start.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	if (!s.trace || s.generation != r.generation.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(r.mutex);
+		if (r.capacity == 0) {
+			return;
+		}
+		s.trace = std::make_shared<ThreadTrace>(s.tid, r.capacity);
+		s.trace->name = s.name;
+		s.generation = r.generation.load(std::memory_order_relaxed);
+		r.threads.push_back(s.trace);
+	}
+
+	ThreadTrace& t = *s.trace;
+	const std::size_t n = t.count.load(std::memory_order_relaxed);
+	if (n == t.capacity) {
+		t.dropped.store(t.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+	t.events[n] = Event{ name, begin, end };
+	t.count.store(n + 1, std::memory_order_release);
+}
+
+void start_trace(std::size_t events_per_thread)
+{
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.threads.clear();
+	r.capacity = events_per_thread > 0 ? events_per_thread : 1;
+	r.start.store(trace_detail::now(), std::memory_order_relaxed);
+	r.generation.fetch_add(1, std::memory_order_release);
+	trace_detail::active.store(true, std::memory_order_relaxed);
+}
+
+void stop_trace()
+{
+	trace_detail::active.store(false, std::memory_order_relaxed);
+}
+
+void set_trace_thread_name(const std::string& name)
+{
+	state.name = name;
+	if (state.trace) {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		state.trace->name = name;
+	}
+}
+
+void write_trace(std::ostream& out)
+{
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	const uint64_t start = r.start.load(std::memory_order_relaxed);
+
+	uint64_t dropped = 0;
+	bool first = true;
+	out << "{\"traceEvents\": [\n";
+	for (const auto& t : r.threads) {
+		if (!t->name.empty()) {
+			out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t->tid <<
+				", \"args\": {\"name\": ";
+			write_string(out, t->name);
+			out << "}}";
+			first = false;
+		}
+
+		const std::size_t n = t->count.load(std::memory_order_acquire);
+		for (std::size_t i = 0; i < n; ++i) {
+			const Event& e = t->events[i];
+			out << (first ? "" : ",\n") << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " <<
+				t->tid << ", \"ts\": " << micros(e.begin - start) << ", \"dur\": " << micros(e.end - e.begin) << "}";
+			first = false;
+		}
+		dropped += t->dropped.load(std::memory_order_relaxed);
+	}
+	out << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": " << dropped << "}}\n";
+}
+
+bool write_trace(const std::string& filename)
+{
+	std::ofstream f(filename);
+	if (!f) {
+		return false;
+	}
+	write_trace(f);
+	f.close();
+	return !f.fail();
+}
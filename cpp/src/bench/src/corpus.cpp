@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "htk_file.h"
+#include "mfcc_htk.h"
+#include "synthetic_signal.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#include <direct.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#include <sys/stat.h>
+#endif
+
+#ifndef ARMA_HTK_BENCH_BUILD
+#define ARMA_HTK_BENCH_BUILD ""
+#endif
+
+using namespace std;
+
+namespace {
+
+	struct Options {
+		string dir = "arma_htk_corpus";
+		int files = 200;
+		double mean = 6;
+		double tail = 0.6;
+		vector<int> rates = { 16000 };
+		int threads = static_cast<int>(max(1u, thread::hardware_concurrency()));
+	};
+
+	/// <summary>	A file of the corpus. </summary>
+	struct Utterance {
+		string raw;
+		string htk;
+		int rate;
+		double seconds;
+	};
+
+	/// <summary>	The figures of one run over the corpus. </summary>
+	struct Run {
+		int threads;
+		double wall;
+		double audio;
+		double p50;
+		double p99;
+		double peak_rss_mb;
+	};
+
+	void usage()
+	{
+		cerr << "USAGE: arma_htk_corpus [options]\n"
+			"\n"
+			" Option                                       Default\n"
+			"\n"
+			" -d dir  Directory of the corpus              arma_htk_corpus\n"
+			" -N n    Number of files                      200\n"
+			" -m s    Mean length in seconds               6\n"
+			" -p s    Tail, sigma of the log length        0.6\n"
+			" -r r,.. Sample rates, e.g. 8000,16000        16000\n"
+			" -j N    Runs with 1, 2, 4, ... N threads     hardware threads\n";
+	}
+
+	void make_dir(const string& dir)
+	{
+#ifdef _WIN32
+		_mkdir(dir.c_str());
+#else
+		mkdir(dir.c_str(), 0755);
+#endif
+	}
+
+	/// <summary>	The peak resident set size of the process in MB. </summary>
+	double peak_rss_mb()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			return 0;
+		}
+		return counters.PeakWorkingSetSize / 1048576.0;
+#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) {
+			return 0;
+		}
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1048576.0;	// bytes
+#else
+		return usage.ru_maxrss / 1024.0;	// kilobytes
+#endif
+#endif
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Writes the corpus, raw 16-bit samples in native byte order. </summary>
+	/// <details>
+	/// The lengths are log-normal with the given mean, a larger tail gives more long files as in
+	/// real corpora. They are drawn from a fixed seed, so the same options give the same corpus.
+	/// The sample rates are assigned in turn.
+	/// </details>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	vector<Utterance> write_corpus(const Options& opt)
+	{
+		make_dir(opt.dir);
+
+		mt19937 random(2024);
+		lognormal_distribution<double> length(log(opt.mean) - opt.tail * opt.tail / 2, opt.tail);
+
+		vector<Utterance> corpus(opt.files);
+		for (int i = 0; i < opt.files; ++i) {
+			Utterance& u = corpus[i];
+			char name[32];
+			snprintf(name, sizeof(name), "/utt%05d", i);
+			u.raw = opt.dir + name + ".raw";
+			u.htk = opt.dir + name + ".htk";
+			u.rate = opt.rates[i % opt.rates.size()];
+			u.seconds = min(max(length(random), 0.5), 60 * opt.mean);
+
+			const vector<arma::s16> samples = synthetic_signal(u.seconds, u.rate, static_cast<uint32_t>(i));
+			u.seconds = static_cast<double>(samples.size()) / u.rate;
+			ofstream f(u.raw, ios::out | ios::binary);
+			f.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(arma::s16));
+			if (!f) {
+				throw runtime_error("cannot write " + u.raw);
+			}
+		}
+		return corpus;
+	}
+
+	/// <summary>	HCopy with TARGETKIND = MFCC_E_D_A and SAVEWITHCRC: 25 ms windows every 10 ms. </summary>
+	MFCC_HTK_Config extractor_config(int rate)
+	{
+		MFCC_HTK_Config config;
+		config.filter_compatibility = true;
+		config.samp_freq = rate;
+		config.win_len = rate / 40;
+		config.win_shift = rate / 100;
+		config.ceps_energy = false;
+		config.raw_energy = true;
+		config.enormalise = true;
+		config.num_threads = 1;
+		return config;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Converts every file of the corpus on the given number of threads. </summary>
+	/// <details>
+	/// Every thread takes the next file, reads it, computes the features and their deltas and
+	/// writes the HTK file. The latency of a file is the time from reading to writing it.
+	/// </details>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	Run run(const vector<Utterance>& corpus, const vector<int>& rates, int threads)
+	{
+		typedef chrono::steady_clock clock;
+
+		vector<double> latency(corpus.size());
+		atomic<size_t> next(0);
+		atomic<int> failed(0);
+
+		auto worker = [&]() {
+			// one extractor per sample rate
+			vector<MFCC_HTK> extractors;
+			for (int rate : rates) {
+				extractors.emplace_back(extractor_config(rate));
+			}
+
+			vector<arma::s16> samples;
+			for (size_t i = next++; i < corpus.size(); i = next++) {
+				const Utterance& u = corpus[i];
+				const auto start = clock::now();
+
+				try {
+					ifstream f(u.raw, ios::in | ios::binary);
+					f.seekg(0, ios::end);
+					samples.resize(f ? static_cast<size_t>(f.tellg()) / sizeof(arma::s16) : 0);
+					f.seekg(0);
+					if (!f.read(reinterpret_cast<char*>(samples.data()), samples.size() * sizeof(arma::s16))) {
+						throw runtime_error("cannot read " + u.raw);
+					}
+
+					MFCC_HTK& mfcc = extractors[find(rates.begin(), rates.end(), u.rate) - rates.begin()];
+					arma::mat feats = mfcc.get_feats(samples.data(), samples.size());
+					feats = mfcc.append_deltas(feats, 2, 2);
+
+					HTKFile out;
+					out.set_data(feats, 100000, "MFCC", { "E", "D", "A", "K" });
+					if (!out.save(u.htk)) {
+						throw runtime_error("cannot write " + u.htk);
+					}
+				}
+				catch (const exception&) {
+					++failed;
+					continue;
+				}
+				latency[i] = chrono::duration<double>(clock::now() - start).count();
+			}
+		};
+
+		const auto start = clock::now();
+		vector<thread> workers;
+		for (int t = 1; t < threads; ++t) {
+			workers.emplace_back(worker);
+		}
+		worker();
+		for (auto& w : workers) {
+			w.join();
+		}
+		const double wall = chrono::duration<double>(clock::now() - start).count();
+
+		if (failed > 0) {
+			throw runtime_error(to_string(failed) + " files could not be converted");
+		}
+
+		double audio = 0;
+		for (const auto& u : corpus) {
+			audio += u.seconds;
+		}
+		sort(latency.begin(), latency.end());
+		auto percentile = [&](double p) {
+			return latency[static_cast<size_t>(p * (latency.size() - 1) + 0.5)];
+		};
+		return Run{ threads, wall, audio, percentile(0.5), percentile(0.99), peak_rss_mb() };
+	}
+
+	string format(const char* fmt, double value)
+	{
+		char buf[64];
+		snprintf(buf, sizeof(buf), fmt, value);
+		return buf;
+	}
+
+	/// <summary>	Writes the report, one run per line, in the format of arma_htk_bench. </summary>
+	void report(ostream& out, const Options& opt, const vector<Run>& runs)
+	{
+		const string build = ARMA_HTK_BENCH_BUILD;
+		string rates;
+		for (size_t i = 0; i < opt.rates.size(); ++i) {
+			rates += (i ? ", " : "") + to_string(opt.rates[i]);
+		}
+		out << "{\n"
+			"  \"config\": {\"build\": \"" << (build.empty() ? "none" : build) << "\", \"files\": " << opt.files <<
+			", \"mean\": " << format("%.1f", opt.mean) << ", \"tail\": " << format("%.2f", opt.tail) <<
+			", \"rates\": [" << rates << "], \"audio_s\": " << format("%.1f", runs.empty() ? 0.0 : runs[0].audio) <<
+			"},\n"
+			"  \"results\": [\n";
+		for (size_t i = 0; i < runs.size(); ++i) {
+			const Run& r = runs[i];
+			out << "    {\"threads\": " << r.threads << ", \"rtf\": " << format("%.5f", r.wall / r.audio) <<
+				", \"files_per_s\": " << format("%.1f", opt.files / r.wall) <<
+				", \"p50_ms\": " << format("%.2f", r.p50 * 1000) << ", \"p99_ms\": " << format("%.2f", r.p99 * 1000) <<
+				", \"peak_rss_mb\": " << format("%.1f", r.peak_rss_mb) << "}" <<
+				(i + 1 < runs.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Benchmarks the conversion of a corpus end to end. Writes a synthetic corpus of raw files,
+///	then reads, extracts MFCC_E_D_A and writes HTK files with 1, 2, 4, ... threads, and reports
+///	the real-time factor (processing time per second of audio), files per second, the median
+///	and 99th percentile latency of a file and the peak resident memory as JSON. The peak memory
+///	is that of the process so far, it can only grow from run to run.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	try {
+		vector<string> args(argv + 1, argv + argc);
+		for (size_t i = 0; i < args.size(); ++i) {
+			const string& a = args[i];
+			if (a.size() == 2 && a[0] == '-' && string("dNmprj").find(a[1]) != string::npos) {
+				if (i + 1 == args.size()) {
+					throw runtime_error("option " + a + " needs an argument");
+				}
+				const string& v = args[++i];
+				switch (a[1]) {
+				case 'd': opt.dir = v; break;
+				case 'N': opt.files = atoi(v.c_str()); break;
+				case 'm': opt.mean = atof(v.c_str()); break;
+				case 'p': opt.tail = atof(v.c_str()); break;
+				case 'j': opt.threads = atoi(v.c_str()); break;
+				case 'r': {
+					opt.rates.clear();
+					istringstream list(v);
+					string rate;
+					while (getline(list, rate, ',')) {
+						opt.rates.push_back(atoi(rate.c_str()));
+					}
+					break;
+				}
+				}
+			}
+			else {
+				usage();
+				return 1;
+			}
+		}
+		if (opt.files < 1 || opt.mean <= 0 || opt.tail < 0 || opt.threads < 1 || opt.rates.empty() ||
+			*min_element(opt.rates.begin(), opt.rates.end()) < 1000) {
+			throw runtime_error("invalid -N, -m, -p, -r or -j");
+		}
+
+		const vector<Utterance> corpus = write_corpus(opt);
+
+		vector<Run> runs;
+		for (int threads = 1; ; threads = min(threads * 2, opt.threads)) {
+			runs.push_back(run(corpus, opt.rates, threads));
+			if (threads == opt.threads) {
+				break;
+			}
+		}
+		report(cout, opt, runs);
+	}
+	catch (const exception& e) {
+		cerr << "arma_htk_corpus: " << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
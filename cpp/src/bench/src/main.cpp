@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "htk_file.h"
+#include "mfcc_htk.h"
+#include "stage_profile.h"
+#include "synthetic_signal.h"
+
+using namespace std;
+
+#ifndef ARMA_HTK_BENCH_BUILD
+#define ARMA_HTK_BENCH_BUILD ""
+#endif
+
+namespace {
+
+	/// <summary>	Number of calls of operator new, see below. </summary>
+	atomic<uint64_t> allocations(0);
+
+	/// <summary>	Number of calls of operator new by the calling thread, charged to the stages. </summary>
+	thread_local uint64_t thread_allocations = 0;
+
+	uint64_t thread_allocation_count()
+	{
+		return thread_allocations;
+	}
+
+	void* allocate(size_t size)
+	{
+		++allocations;
+		++thread_allocations;
+		if (void* p = malloc(size == 0 ? 1 : size)) {
+			return p;
+		}
+		throw bad_alloc();
+	}
+
+	struct Options {
+		double seconds = 60;
+		int rate = 16000;
+		int repeat = 10;
+		bool single = false;
+		string output;
+		string htk = "arma_htk_bench.htk";
+	};
+
+	/// <summary>	One line of the report. </summary>
+	struct Result {
+		string name;
+		double ns_per_frame;
+		double allocs_per_frame;	// negative if not measured
+		double cycles_per_frame;	// negative if not measured
+	};
+
+	void usage()
+	{
+		cerr << "USAGE: arma_htk_bench [options]\n"
+			"\n"
+			" Option                                       Default\n"
+			"\n"
+			" -s N    Seconds of synthetic signal          60\n"
+			" -r N    Sample rate in Hz                    16000\n"
+			" -n N    Timed runs of every benchmark        10\n"
+			" -f      Single precision (MFCC_HTK_F)        double\n"
+			" -o f    Write the JSON report to f           stdout\n"
+			" -t f    Temporary HTK file                   arma_htk_bench.htk\n";
+	}
+
+	/// <summary>	The median of values, which must not be empty. </summary>
+	double median(vector<double> values)
+	{
+		sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// <summary>	Times fn, the median of the runs after one warm-up run. </summary>
+	///
+	/// <param name="fn">	 	The benchmark. </param>
+	/// <param name="frames">	Frames processed by one run. </param>
+	/// <param name="repeat">	Number of timed runs. </param>
+	/// <param name="warm">  	(Optional) called after the warm-up run. </param>
+	/// <param name="after"> 	(Optional) called after every timed run, outside the timing. </param>
+	////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	Result measure(const string& name, const function<void()>& fn, arma::uword frames, int repeat,
+		const function<void()>& warm = function<void()>(), const function<void()>& after = function<void()>())
+	{
+		fn();
+		if (warm) {
+			warm();
+		}
+
+		vector<double> ns, allocs;
+		for (int i = 0; i < repeat; ++i) {
+			const uint64_t before = allocations;
+			const auto start = chrono::steady_clock::now();
+			fn();
+			ns.push_back(static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(
+				chrono::steady_clock::now() - start).count()));
+			allocs.push_back(static_cast<double>(allocations - before));
+			if (after) {
+				after();
+			}
+		}
+		return Result{ name, median(ns) / frames, median(allocs) / frames, -1 };
+	}
+
+	template<typename eT>
+	vector<Result> run(const Options& opt, string& info)
+	{
+		typedef typename MFCC_HTK_T<eT>::mat_type mat_type;
+
+		// 25 ms windows every 10 ms with _E and _Z, so every stage has work to do
+		MFCC_HTK_Config config;
+		config.filter_compatibility = true;
+		config.samp_freq = opt.rate;
+		config.win_len = opt.rate / 40;
+		config.win_shift = opt.rate / 100;
+		config.ceps_energy = false;
+		config.raw_energy = true;
+		config.enormalise = true;
+		config.cmn = true;
+		config.num_threads = 1;
+		MFCC_HTK_T<eT> mfcc(config);
+
+		const vector<arma::s16> signal = synthetic_signal(opt.seconds, opt.rate);
+		mat_type feats = mfcc.get_feats(signal.data(), signal.size());
+		const arma::uword frames = feats.n_cols;
+		if (frames == 0) {
+			throw runtime_error("the signal is shorter than a window");
+		}
+		info = "\"frames\": " + to_string(frames) + ", \"features\": " + to_string(feats.n_rows);
+
+		// a snapshot of the profile after the warm-up run and after every timed run
+		vector<Result> results;
+		vector<StageProfile> snapshots;
+		results.push_back(measure("get_feats", [&]() {
+			feats = mfcc.get_feats(signal.data(), signal.size());
+		}, frames, opt.repeat, [&]() {
+			reset_stage_profile();
+			snapshots.assign(1, stage_profile());
+		}, [&]() {
+			snapshots.push_back(stage_profile());
+		}));
+
+		// like the totals, the figures of a stage are the median of its figures in the timed runs
+		if (stage_profile_enabled()) {
+			for (int s = 0; s <= static_cast<int>(ProfileStage::cmn); ++s) {
+				vector<double> ns, allocs, cycles;
+				for (size_t i = 1; i < snapshots.size(); ++i) {
+					const StageProfile run = snapshots[i].since(snapshots[i - 1]);
+					const double total = static_cast<double>(run[ProfileStage::convert].frames);
+					ns.push_back(run.stages[s].ns / total);
+					allocs.push_back(run.stages[s].allocations / total);
+					cycles.push_back(run.stages[s].cycles / total);
+				}
+				results.push_back(Result{ string("get_feats/") + profile_stage_name(static_cast<ProfileStage>(s)),
+					median(ns), median(allocs), median(cycles) });
+			}
+		}
+
+		mat_type deltas;
+		results.push_back(measure("get_delta", [&]() {
+			deltas = mfcc.get_delta(feats, 2);
+		}, frames, opt.repeat));
+		results.push_back(measure("append_deltas", [&]() {
+			deltas = mfcc.append_deltas(feats, 2, 2);
+		}, frames, opt.repeat));
+
+		// the file HCopy writes for MFCC_E_D_A_Z with SAVEWITHCRC
+		HTKFile_T<eT> out;
+		out.set_data(deltas, 100000, "MFCC", { "E", "D", "A", "Z", "K" });
+		if (!out.save(opt.htk)) {
+			throw runtime_error("cannot write " + opt.htk);
+		}
+		HTKFile_T<eT> in;
+		results.push_back(measure("htk_load", [&]() {
+			if (!in.load(opt.htk, true)) {
+				throw runtime_error("cannot read " + opt.htk);
+			}
+		}, frames, opt.repeat));
+		remove(opt.htk.c_str());
+
+		return results;
+	}
+
+	string format(const char* fmt, double value)
+	{
+		char buf[64];
+		snprintf(buf, sizeof(buf), fmt, value);
+		return buf;
+	}
+
+	/// <summary>	Writes the report, one result per line with fixed precision, so reports diff well. </summary>
+	void report(ostream& out, const Options& opt, const string& info, const vector<Result>& results)
+	{
+		const string build = ARMA_HTK_BENCH_BUILD;
+		out << "{\n"
+			"  \"config\": {\"build\": \"" << (build.empty() ? "none" : build) << "\", \"seconds\": " <<
+			format("%.1f", opt.seconds) << ", \"rate\": " << opt.rate << ", \"repeat\": " << opt.repeat <<
+			", \"precision\": \"" << (opt.single ? "float" : "double") << "\", " << info << "},\n"
+			"  \"results\": [\n";
+		for (size_t i = 0; i < results.size(); ++i) {
+			const Result& r = results[i];
+			out << "    {\"name\": \"" << r.name << "\", \"frames_per_s\": " <<
+				format("%.0f", r.ns_per_frame > 0 ? 1e9 / r.ns_per_frame : 0.0) <<
+				", \"ns_per_frame\": " << format("%.1f", r.ns_per_frame);
+			if (r.allocs_per_frame >= 0) {
+				out << ", \"allocs_per_frame\": " << format("%.3f", r.allocs_per_frame);
+			}
+			if (r.cycles_per_frame >= 0) {
+				out << ", \"cycles_per_frame\": " << format("%.0f", r.cycles_per_frame);
+			}
+			out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+	}
+}
+
+// Every allocation of the process is counted, including those of arma_htk and Armadillo.
+void* operator new(size_t size)
+{
+	return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+#ifdef __cpp_aligned_new
+
+namespace {
+
+	void* allocate(size_t size, align_val_t alignment)
+	{
+		++allocations;
+		++thread_allocations;
+		const size_t a = static_cast<size_t>(alignment);
+#ifdef _WIN32
+		void* p = _aligned_malloc(size == 0 ? 1 : size, a);
+#else
+		void* p = aligned_alloc(a, (size + a - 1) / a * a + (size == 0 ? a : 0));
+#endif
+		if (!p) {
+			throw bad_alloc();
+		}
+		return p;
+	}
+
+	void deallocate(void* p)
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+}
+
+void* operator new(size_t size, align_val_t alignment)
+{
+	return allocate(size, alignment);
+}
+
+void* operator new[](size_t size, align_val_t alignment)
+{
+	return allocate(size, alignment);
+}
+
+void operator delete(void* p, align_val_t) noexcept
+{
+	deallocate(p);
+}
+
+void operator delete[](void* p, align_val_t) noexcept
+{
+	deallocate(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept
+{
+	deallocate(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t) noexcept
+{
+	deallocate(p);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Benchmarks the extraction on a synthetic signal. Times get_feats and each of its stages,
+///	get_delta, append_deltas and HTKFile::load, and reports frames per second, nanoseconds and
+///	allocations per frame as JSON. Every figure, including those of the stages, is the median of
+///	several runs, so the reports of two commits can be compared with diff. Compare Release builds, the build type is part of
+///	the report.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	set_allocation_counter(thread_allocation_count);
+	try {
+		vector<string> args(argv + 1, argv + argc);
+		for (size_t i = 0; i < args.size(); ++i) {
+			const string& a = args[i];
+			if (a == "-f") {
+				opt.single = true;
+			}
+			else if (a.size() == 2 && a[0] == '-' && string("srnot").find(a[1]) != string::npos) {
+				if (i + 1 == args.size()) {
+					throw runtime_error("option " + a + " needs an argument");
+				}
+				const string& v = args[++i];
+				switch (a[1]) {
+				case 's': opt.seconds = atof(v.c_str()); break;
+				case 'r': opt.rate = atoi(v.c_str()); break;
+				case 'n': opt.repeat = atoi(v.c_str()); break;
+				case 'o': opt.output = v; break;
+				case 't': opt.htk = v; break;
+				}
+			}
+			else {
+				usage();
+				return 1;
+			}
+		}
+		if (opt.seconds <= 0 || opt.rate < 1000 || opt.repeat < 1) {
+			throw runtime_error("invalid -s, -r or -n");
+		}
+
+		string info;
+		const vector<Result> results = opt.single ? run<float>(opt, info) : run<double>(opt, info);
+
+		if (opt.output.empty()) {
+			report(cout, opt, info, results);
+		}
+		else {
+			ofstream out(opt.output);
+			report(out, opt, info, results);
+			if (!out) {
+				throw runtime_error("cannot write " + opt.output);
+			}
+		}
+	}
+	catch (const exception& e) {
+		cerr << "arma_htk_bench: " << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	synthetic_signal.h
+//
+// summary:	Declares synthetic_signal, the test signal of the benchmarks
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <armadillo>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	A reproducible signal that looks a little like speech. </summary>
+/// <details>
+/// A harmonic series on a slowly moving pitch, modulated at a syllable rate, plus noise from
+/// a fixed seed, so every run and every commit sees the same samples.
+/// </details>
+///
+/// <param name="seconds">	Length of the signal. </param>
+/// <param name="rate">   	Sample rate in Hz. </param>
+/// <param name="seed">   	(Optional) seed of the noise. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline std::vector<arma::s16> synthetic_signal(double seconds, int rate, uint32_t seed = 12345)
+{
+	const std::size_t n = static_cast<std::size_t>(seconds * rate);
+	std::vector<arma::s16> samples(n);
+	double phase = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const double t = static_cast<double>(i) / rate;
+		const double pitch = 120 + 30 * std::sin(2 * arma::datum::pi * 0.5 * t);
+		phase += 2 * arma::datum::pi * pitch / rate;
+		double x = 0;
+		for (int h = 1; h <= 10 && h * pitch < rate / 2; ++h) {
+			x += std::sin(h * phase) / h;
+		}
+		const double envelope = 0.5 + 0.5 * std::sin(2 * arma::datum::pi * 4 * t);
+		seed = seed * 1664525u + 1013904223u;
+		const double noise = (static_cast<double>(seed >> 8) / (1 << 24)) - 0.5;
+		samples[i] = static_cast<arma::s16>(4000 * envelope * x + 200 * noise);
+	}
+	return samples;
+}
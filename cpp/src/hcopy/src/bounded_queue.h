@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	bounded_queue.h
+//
+// summary:	Declares the BoundedQueue class connecting the stages of the hcopy pipeline
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include "trace_events.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	A queue of at most capacity items between producer and consumer threads. </summary>
+/// <details>
+/// push waits while the queue is full, so a fast stage cannot run ahead of a slow one by more
+/// than capacity items. After close() the remaining items can still be popped. The waits are
+/// recorded as trace events, see trace_events.h.
+/// </details>
+///
+/// <typeparam name="T">	The item type. </typeparam>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+class BoundedQueue
+{
+public:
+
+	explicit BoundedQueue(std::size_t capacity) : capacity_(capacity > 0 ? capacity : 1), closed_(false) {}
+
+	/// <summary>	Adds an item, waits while the queue is full. </summary>
+	void push(T item)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (items_.size() >= capacity_) {
+			TraceScope trace("queue_wait_push");
+			not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+		}
+		items_.push_back(std::move(item));
+		not_empty_.notify_one();
+	}
+
+	/// <summary>	Takes the oldest item, waits while the queue is empty and open. </summary>
+	///
+	/// <returns>	false if the queue is closed and empty. </returns>
+	bool pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (items_.empty() && !closed_) {
+			TraceScope trace("queue_wait_pop");
+			not_empty_.wait(lock, [this] { return !items_.empty() || closed_; });
+		}
+		if (items_.empty()) {
+			return false;
+		}
+		item = std::move(items_.front());
+		items_.pop_front();
+		not_full_.notify_one();
+		return true;
+	}
+
+	/// <summary>	Marks the end of the items. </summary>
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed_ = true;
+		not_empty_.notify_all();
+	}
+
+private:
+	std::size_t capacity_;
+	bool closed_;
+	std::deque<T> items_;
+	std::mutex mutex_;
+	std::condition_variable not_full_;
+	std::condition_variable not_empty_;
+};
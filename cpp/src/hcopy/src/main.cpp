@@ -0,0 +1,263 @@
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "bounded_queue.h"
+#include "htk_config.h"
+#include "htk_file.h"
+#include "mfcc_htk.h"
+#include "trace_events.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	A file on its way through the pipeline. </summary>
+	struct Job {
+		string source;
+		string target;
+		vector<arma::s16> samples;
+		arma::mat feats;
+	};
+
+	void usage()
+	{
+		cerr << "USAGE: arma_hcopy [options] src tgt [src tgt ...]\n"
+			"\n"
+			" Option                                       Default\n"
+			"\n"
+			" -C cf   Set config file to cf (repeatable)   none\n"
+			" -S f    Set script file to f                 none\n"
+			" -T N    Set trace flags to N                 0\n"
+			" -j N    Extraction threads                   hardware threads\n"
+			" -q N    Files queued between the stages      16\n"
+			" -J f    Write a Chrome trace of the run to f none\n";
+	}
+
+	/// <summary>	Reads the lines "src tgt" of an HCopy script. </summary>
+	void read_script(const string& filename, vector<pair<string, string>>& jobs)
+	{
+		ifstream f(filename);
+		if (!f) {
+			throw runtime_error("cannot open script " + filename);
+		}
+
+		string line;
+		int number = 0;
+		while (getline(f, line)) {
+			++number;
+			istringstream words(line);
+			string src, tgt, extra;
+			if (!(words >> src)) {
+				continue;
+			}
+			if (!(words >> tgt) || (words >> extra)) {
+				throw runtime_error("expected \"src tgt\" in line " + to_string(number) + " of " + filename);
+			}
+			jobs.emplace_back(src, tgt);
+		}
+	}
+
+	/// <summary>	Reads a raw file of 16-bit samples (SOURCEFORMAT = NOHEAD). </summary>
+	void read_samples(const string& filename, vector<arma::s16>& samples)
+	{
+		ifstream f(filename, ios::in | ios::binary);
+		if (!f) {
+			throw runtime_error("cannot open " + filename);
+		}
+		f.seekg(0, ios::end);
+		const streamoff size = f.tellg();
+		f.seekg(0);
+		samples.resize(static_cast<size_t>(size) / sizeof(arma::s16));
+		if (!f.read(reinterpret_cast<char*>(samples.data()), samples.size() * sizeof(arma::s16))) {
+			throw runtime_error("cannot read " + filename);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Converts raw audio files to HTK feature files like HCopy, configured by the same config files.
+///	Reading, feature extraction and writing are pipelined: one thread reads the source files,
+///	several threads compute the features and one thread writes the target files. The stages are
+///	connected by bounded queues, so at most a few files are held in memory at any time.
+///	With -J the reads, the extraction, the writes and the waits on the queues are recorded and
+///	written as a Chrome trace, which shows which stage limits the throughput.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	HTKConfig config;
+	vector<pair<string, string>> jobs;
+	int trace = 0;
+	int threads = static_cast<int>(thread::hardware_concurrency());
+	size_t depth = 16;
+	string trace_file;
+
+	try {
+		vector<string> args(argv + 1, argv + argc);
+		vector<string> files;
+		for (size_t i = 0; i < args.size(); ++i) {
+			const string& a = args[i];
+			if (a.size() == 2 && a[0] == '-' && string("CSTjqJ").find(a[1]) != string::npos) {
+				if (i + 1 == args.size()) {
+					throw runtime_error("option " + a + " needs an argument");
+				}
+				const string& v = args[++i];
+				switch (a[1]) {
+				case 'C': config.load(v); break;
+				case 'S': read_script(v, jobs); break;
+				case 'T': trace = atoi(v.c_str()); break;
+				case 'j': threads = atoi(v.c_str()); break;
+				case 'q': depth = static_cast<size_t>(atoi(v.c_str())); break;
+				case 'J': trace_file = v; break;
+				}
+			}
+			else if (!a.empty() && a[0] == '-') {
+				throw runtime_error("unknown option " + a);
+			}
+			else {
+				files.push_back(a);
+			}
+		}
+
+		if (files.size() % 2 != 0) {
+			throw runtime_error("source and target files must come in pairs");
+		}
+		for (size_t i = 0; i < files.size(); i += 2) {
+			jobs.emplace_back(files[i], files[i + 1]);
+		}
+		if (jobs.empty()) {
+			usage();
+			return 1;
+		}
+	}
+	catch (const exception& e) {
+		cerr << "arma_hcopy: " << e.what() << endl;
+		return 1;
+	}
+
+	HCopySettings settings;
+	try {
+		settings = config.hcopy_settings();
+		settings.mfcc.num_threads = 1;
+
+		// the workers construct their extractors without a handler, reject the config here
+		MFCC_HTK check(settings.mfcc);
+	}
+	catch (const exception& e) {
+		cerr << "arma_hcopy: " << e.what() << endl;
+		return 1;
+	}
+	threads = max(threads, 1);
+
+	if (!trace_file.empty()) {
+		start_trace();
+		set_trace_thread_name("reader");
+	}
+
+	BoundedQueue<Job> read_queue(depth);
+	BoundedQueue<Job> write_queue(depth);
+	atomic<int> failed(0);
+	atomic<int> extractors(threads);
+	mutex log_mutex;
+
+	auto fail = [&](const Job& job, const string& what) {
+		lock_guard<mutex> lock(log_mutex);
+		cerr << "arma_hcopy: " << job.source << ": " << what << endl;
+		++failed;
+	};
+
+	// extraction stage, every thread with its own extractor
+	vector<thread> workers;
+	for (int t = 0; t < threads; ++t) {
+		workers.emplace_back([&, t]() {
+			set_trace_thread_name("extractor " + to_string(t + 1));
+			MFCC_HTK mfcc(settings.mfcc);
+			Job job;
+			while (read_queue.pop(job)) {
+				try {
+					job.feats = mfcc.get_feats(job.samples.data(), job.samples.size());
+					if (settings.delta_order > 0) {
+						job.feats = mfcc.append_deltas(job.feats, settings.deltawin, settings.delta_order);
+					}
+					vector<arma::s16>().swap(job.samples);
+					write_queue.push(move(job));
+				}
+				catch (const exception& e) {
+					fail(job, e.what());
+				}
+			}
+			if (--extractors == 0) {
+				write_queue.close();
+			}
+		});
+	}
+
+	// writing stage
+	thread writer([&]() {
+		set_trace_thread_name("writer");
+		Job job;
+		while (write_queue.pop(job)) {
+			try {
+				HTKFile out(FeatureLayout::frame_major, settings.order);
+				out.set_data(job.feats, settings.target_rate, settings.basic_kind, settings.qualifiers);
+				if (!out.save(job.target)) {
+					throw runtime_error("cannot write " + job.target);
+				}
+				if (trace > 0) {
+					lock_guard<mutex> lock(log_mutex);
+					cout << job.source << " -> " << job.target << " (" << job.feats.n_cols << " frames)" << endl;
+				}
+			}
+			catch (const exception& e) {
+				fail(job, e.what());
+			}
+		}
+	});
+
+	// reading stage, in the calling thread
+	for (const auto& j : jobs) {
+		Job job;
+		job.source = j.first;
+		job.target = j.second;
+		try {
+			{
+				TraceScope trace("read_file");
+				read_samples(job.source, job.samples);
+			}
+			read_queue.push(move(job));
+		}
+		catch (const exception& e) {
+			fail(job, e.what());
+		}
+	}
+	read_queue.close();
+
+	for (auto& w : workers) {
+		w.join();
+	}
+	writer.join();
+
+	if (!trace_file.empty()) {
+		stop_trace();
+		if (!write_trace(trace_file)) {
+			cerr << "arma_hcopy: cannot write " << trace_file << endl;
+			return 1;
+		}
+	}
+
+	if (failed > 0) {
+		cerr << "arma_hcopy: " << failed << " of " << jobs.size() << " files failed" << endl;
+		return 1;
+	}
+	return 0;
+}
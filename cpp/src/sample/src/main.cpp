@@ -34,12 +34,30 @@ int main(int argc, char** argv)
 //	sig = sig - arma::mean(sig);
 
 	// here we calculate the MFCC + energy, deltas and acceleration coefficients
+	// (the same as stacking mfcc.get_delta(feat, 2) and get_delta of that under feat)
 	auto feat = mfcc.get_feats(sig);
-	auto delta = mfcc.get_delta(feat, 2);
-	auto acc = mfcc.get_delta(delta, 2);
 
 	// here we merge the MFCCs and deltas together to get 39 features
-	feat = arma::hstack(feat, delta, acc);
+	feat = mfcc.append_deltas(feat, 2, 2);
+
+	// the same in single precision
+	MFCC_HTK_F mfcc_f{ config };
+	auto sig_f = mfcc_f.load_raw_signal("./example/file.raw");
+	auto feat_f = mfcc_f.append_deltas(mfcc_f.get_feats(sig_f), 2, 2);
+
+	std::cout << "Maximum float/double difference: "
+		<< arma::abs(arma::conv_to<arma::mat>::from(feat_f) - feat).max() << std::endl;
+
+	// here we save our features in the same format as hcopy (TARGETKIND = MFCC_D_A_0),
+	// in process, and read them back
+	HTKFile out;
+	out.set_data(feat, 100000, "MFCC", { "0", "D", "A" });
+	out.save("./example/file_arma.htk");
+
+	HTKFile saved;
+	saved.load("./example/file_arma.htk");
+	std::cout << "Maximum save/load difference: "
+		<< arma::abs(saved.data() - feat).max() << std::endl;
 
 	// here we use HTK to calculate the same thing
 	// you can comment this line if you don't have HTK installed
@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	check.h
+//
+// summary:	Declares the CHECK macro of the tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iostream>
+
+/// <summary>	Number of failed checks of the test. </summary>
+inline int& check_failures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+/// <summary>	Reports a condition that does not hold and goes on with the test. </summary>
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": failed: " #condition << std::endl; \
+			++check_failures(); \
+		} \
+	} while (0)
+
+/// <summary>	The exit code of the test, 1 if a check failed. </summary>
+inline int check_result()
+{
+	if (check_failures() > 0) {
+		std::cerr << check_failures() << " checks failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
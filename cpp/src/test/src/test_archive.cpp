@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <armadillo>
+#include "check.h"
+#include "feature_archive.h"
+
+using namespace std;
+
+namespace {
+
+	const char* const prefix = "test_archive";
+
+	/// <summary>	Deletes the files of the archive. </summary>
+	void remove_archive(int shards)
+	{
+		for (int s = 0; s < shards; ++s) {
+			char name[64];
+			snprintf(name, sizeof(name), "%s.%05d.shard", prefix, s);
+			remove(name);
+		}
+		remove((string(prefix) + ".index").c_str());
+	}
+
+	/// <summary>	Writes matrices of random sizes and reads them back by key. </summary>
+	void check_archive(ArchiveEncoding encoding)
+	{
+		map<string, arma::fmat> written;
+		{
+			// small shards, so the matrices are spread over several of them
+			ArchiveWriter writer(prefix, encoding, FeatureLayout::frame_major, 64 * 1024);
+			for (int i = 0; i < 50; ++i) {
+				const string key = "utt" + to_string((i * 37) % 50);
+				const arma::fmat m = arma::randn<arma::fmat>(13, 1 + (i * 53) % 400);
+				writer.add(key, m, 100000, "MFCC", { "E" });
+				written[key] = m;
+			}
+			CHECK(writer.size() == 50);
+		}
+
+		ArchiveReader reader(prefix);
+		CHECK(reader.size() == written.size());
+		size_t i = 0;
+		uint32_t shards = 0;
+		for (const auto& w : written) {
+			// the keys are sorted
+			CHECK(reader.key(i) == w.first);
+			CHECK(reader.find(w.first) == i);
+			const ArchiveReader::Entry e = reader.entry(i++);
+			shards = max(shards, e.shard + 1);
+			CHECK(e.frames == w.second.n_cols && e.dims == w.second.n_rows && e.samp_period == 100000);
+
+			const arma::mat m = reader.load(w.first);
+			CHECK(arma::approx_equal(m, arma::conv_to<arma::mat>::from(w.second), "absdiff", 0));
+			if (encoding == ArchiveEncoding::native_float) {
+				const ArchiveReader::View v = reader.view(w.first);
+				CHECK(v.n_rows == w.second.n_rows && v.n_cols == w.second.n_cols);
+				CHECK(arma::approx_equal(v.mat(), w.second, "absdiff", 0));
+				if (v.n_cols > 0) {
+					CHECK(v(v.n_rows - 1, v.n_cols - 1) == w.second(v.n_rows - 1, v.n_cols - 1));
+					CHECK(v.colptr(v.n_cols - 1)[0] == w.second(0, v.n_cols - 1));
+				}
+
+				// changing a copy of the view changes neither later views nor loads of the key
+				arma::fmat changed = v.mat();
+				changed.fill(42);
+				CHECK(arma::approx_equal(reader.view(w.first).mat(), w.second, "absdiff", 0));
+				CHECK(arma::approx_equal(reader.load(w.first), arma::conv_to<arma::mat>::from(w.second), "absdiff", 0));
+			}
+		}
+		CHECK(shards > 1);
+		CHECK(!reader.contains("utt50"));
+		CHECK(reader.find("a") == reader.size());
+
+		bool thrown = false;
+		try {
+			reader.load("missing");
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		// an htk entry cannot be viewed without decoding it
+		thrown = false;
+		try {
+			reader.view("utt0");
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown == (encoding == ArchiveEncoding::htk));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks the feature archive: matrices written over several shards are found by key, loaded
+///	and viewed unchanged in both encodings, and missing keys are reported.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	check_archive(ArchiveEncoding::native_float);
+	remove_archive(100);
+	check_archive(ArchiveEncoding::htk);
+	remove_archive(100);
+
+	// a key added twice is rejected when the index is written
+	bool thrown = false;
+	try {
+		ArchiveWriter writer(prefix);
+		writer.add("a", arma::mat(2, 2, arma::fill::zeros));
+		writer.add("a", arma::mat(2, 2, arma::fill::zeros));
+		writer.close();
+	}
+	catch (const runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	remove_archive(1);
+	return check_result();
+}
@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "check.h"
+#include "batch_loader.h"
+#include "feature_archive.h"
+#include "htk_file.h"
+
+using namespace std;
+
+namespace {
+
+	const char* const prefix = "test_batch_loader";
+
+	/// <summary>	Whether fn throws std::runtime_error. </summary>
+	template<typename F>
+	bool throws(F fn)
+	{
+		try {
+			fn();
+		}
+		catch (const runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>	The samples of the files as HTKFile::load returns them. </summary>
+	template<typename eT>
+	vector<arma::Mat<eT>> load_files(const vector<string>& paths)
+	{
+		vector<arma::Mat<eT>> refs;
+		for (const string& path : paths) {
+			HTKFile_T<eT> file;
+			CHECK(file.load(path));
+			refs.push_back(file.data());
+		}
+		return refs;
+	}
+
+	/// <summary>	Compares every utterance of a batch with its reference. </summary>
+	template<typename eT>
+	void check_batch(typename BatchLoader_T<eT>::Batch& batch, const vector<arma::Mat<eT>>& refs)
+	{
+		CHECK(batch.size() == refs.size());
+		arma::uword frames = 0;
+		for (size_t i = 0; i < refs.size() && i < batch.size(); ++i) {
+			CHECK(batch.offset(i) == frames);
+			CHECK(batch.features() == refs[i].n_rows);
+			CHECK(batch.frames(i) == refs[i].n_cols);
+			CHECK(arma::approx_equal(batch.utterance(i), refs[i], "absdiff", 0));
+			frames += batch.frames(i);
+		}
+		CHECK(batch.frames() == frames);
+	}
+
+	/// <summary>	Loads the files twice, the second time into the recycled batch. </summary>
+	template<typename eT>
+	void check_files(vector<string> paths)
+	{
+		BatchLoader_T<eT> loader(3);
+		auto batch = loader.load(paths);
+		check_batch<eT>(*batch, load_files<eT>(paths));
+		const eT* mem = batch->memptr();
+
+		// the same frames in another order fit in the buffer of the recycled batch
+		loader.recycle(move(batch));
+		CHECK(loader.pooled() == 1);
+		paths = vector<string>(paths.rbegin(), paths.rend());
+		batch = loader.load(paths);
+		CHECK(loader.pooled() == 0);
+		CHECK(batch->memptr() == mem);
+		check_batch<eT>(*batch, load_files<eT>(paths));
+
+		// a batch that is still in use is not reused
+		auto other = loader.load(paths);
+		CHECK(other->memptr() != batch->memptr());
+		check_batch<eT>(*other, load_files<eT>(paths));
+	}
+
+	/// <summary>	Loads archive entries twice and compares them with the files they were made of. </summary>
+	template<typename eT>
+	void check_archive(ArchiveEncoding encoding, const vector<string>& paths, const vector<string>& keys)
+	{
+		vector<arma::Mat<eT>> refs = load_files<eT>(paths);
+		if (encoding == ArchiveEncoding::native_float) {
+			// the entries are the samples of a double load rounded to float
+			const vector<arma::mat> doubles = load_files<double>(paths);
+			for (size_t i = 0; i < refs.size(); ++i) {
+				refs[i] = arma::conv_to<arma::Mat<eT>>::from(arma::conv_to<arma::fmat>::from(doubles[i]));
+			}
+		}
+
+		ArchiveReader archive(prefix);
+
+		BatchLoader_T<eT> loader(3);
+		auto batch = loader.load(archive, keys);
+		check_batch<eT>(*batch, refs);
+		loader.recycle(move(batch));
+		batch = loader.load(archive, keys);
+		check_batch<eT>(*batch, refs);
+
+		CHECK(throws([&] { loader.load(archive, { keys[0], "missing" }); }));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that BatchLoader returns the samples HTKFile::load returns for every file, also into a
+///	recycled batch, for plain and compressed files and for both encodings of archive entries.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	vector<string> paths, keys;
+	for (int i = 0; i < 7; ++i) {
+		HTKFile out;
+		const arma::fmat data = arma::randn<arma::fmat>(13, 1 + (i * 211) % 700);
+		out.set_data(arma::conv_to<arma::mat>::from(data), 100000, "MFCC", i % 2 ? set<string>{ "E", "C" } : set<string>{ "E" });
+		paths.push_back(string(prefix) + to_string(i) + ".htk");
+		keys.push_back("utt" + to_string(i));
+		CHECK(out.save(paths.back()));
+	}
+
+	check_files<double>(paths);
+	check_files<float>(paths);
+
+	for (ArchiveEncoding encoding : { ArchiveEncoding::native_float, ArchiveEncoding::htk }) {
+		{
+			ArchiveWriter writer(prefix, encoding);
+			for (size_t i = 0; i < paths.size(); ++i) {
+				HTKFile file;
+				CHECK(file.load(paths[i]));
+				writer.add(keys[i], file.data(), file.samp_period(), file.basic_kind(), file.qualifiers());
+			}
+		}
+		check_archive<double>(encoding, paths, keys);
+		check_archive<float>(encoding, paths, keys);
+	}
+
+	// the files of a batch must have the same number of features
+	HTKFile out;
+	out.set_data(arma::randn(12, 10), 100000, "MFCC");
+	CHECK(out.save(string(prefix) + ".12.htk"));
+	BatchLoader loader;
+	CHECK(throws([&] { loader.load({ paths[0], string(prefix) + ".12.htk" }); }));
+	CHECK(throws([&] { loader.load({ paths[0], string(prefix) + ".missing.htk" }); }));
+
+	for (const string& path : paths) {
+		remove(path.c_str());
+	}
+	remove((string(prefix) + ".12.htk").c_str());
+	remove((string(prefix) + ".00000.shard").c_str());
+	remove((string(prefix) + ".index").c_str());
+	return check_result();
+}
@@ -0,0 +1,52 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "check.h"
+#include "crc16.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	The CRC computed one bit at a time. </summary>
+	uint16_t crc16_bitwise(const char* data, size_t n)
+	{
+		uint16_t crc = 0;
+		for (size_t i = 0; i < n; ++i) {
+			crc ^= static_cast<uint16_t>(static_cast<unsigned char>(data[i]) << 8);
+			for (int b = 0; b < 8; ++b) {
+				crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+			}
+		}
+		return crc;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks the CRC of the K qualifier: the check value of CRC-16/XMODEM, the bitwise definition
+///	for every length around the 8-byte steps, and continuing a CRC over several parts.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	const string check = "123456789";
+	CHECK(crc16_update(0, check.data(), check.size()) == 0x31C3);
+	CHECK(crc16_update(0, nullptr, 0) == 0);
+
+	arma::arma_rng::set_seed(1);
+	const arma::Col<arma::u16> random = arma::randi<arma::Col<arma::u16>>(1000, arma::distr_param(0, 255));
+	vector<char> data(random.begin(), random.end());
+	for (size_t n = 0; n <= 40; ++n) {
+		CHECK(crc16_update(0, data.data(), n) == crc16_bitwise(data.data(), n));
+	}
+	const uint16_t all = crc16_bitwise(data.data(), data.size());
+	CHECK(crc16_update(0, data.data(), data.size()) == all);
+	for (size_t split : { 1, 7, 8, 9, 500, 999 }) {
+		const uint16_t first = crc16_update(0, data.data(), split);
+		CHECK(crc16_update(first, data.data() + split, data.size() - split) == all);
+	}
+	return check_result();
+}
@@ -0,0 +1,62 @@
+#include <armadillo>
+#include "check.h"
+#include "mfcc_htk.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	Compares append_deltas with get_delta chained order times and stacked. </summary>
+	template<typename eT>
+	void check_deltas(const arma::Mat<eT>& statics, FeatureLayout layout, int deltawin, int order)
+	{
+		MFCC_HTK_Config config;
+		config.layout = layout;
+		MFCC_HTK_T<eT> mfcc(config);
+		const bool frame_major = layout == FeatureLayout::frame_major;
+		const arma::Mat<eT> feats = frame_major ? statics : arma::Mat<eT>(statics.t());
+
+		arma::Mat<eT> ref = feats;
+		arma::Mat<eT> delta = feats;
+		for (int l = 0; l < order; ++l) {
+			delta = mfcc.get_delta(delta, deltawin);
+			if (frame_major) {
+				ref = arma::join_cols(ref, delta);
+			}
+			else {
+				ref = arma::join_rows(ref, delta);
+			}
+		}
+
+		const arma::Mat<eT> all = mfcc.append_deltas(feats, deltawin, order);
+		CHECK(all.n_rows == ref.n_rows && all.n_cols == ref.n_cols);
+		if (all.n_rows == ref.n_rows && all.n_cols == ref.n_cols) {
+			CHECK(arma::approx_equal(all, ref, "absdiff", 0));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that append_deltas gives the same values as stacking chained get_delta calls, for
+///	both layouts and utterances shorter than the delta window.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	for (arma::uword frames : { 1, 2, 5, 300 }) {
+		const arma::mat statics = arma::randn(13, frames) * 10;
+		const arma::fmat fstatics = arma::conv_to<arma::fmat>::from(statics);
+		for (int deltawin : { 1, 2, 3 }) {
+			for (int order = 0; order <= 3; ++order) {
+				for (FeatureLayout layout : { FeatureLayout::frame_major, FeatureLayout::feature_major }) {
+					check_deltas(statics, layout, deltawin, order);
+					check_deltas(fstatics, layout, deltawin, order);
+				}
+			}
+		}
+	}
+	return check_result();
+}
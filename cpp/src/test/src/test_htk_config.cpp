@@ -0,0 +1,162 @@
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "check.h"
+#include "htk_config.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	A configuration of the given lines. </summary>
+	HTKConfig parse(const string& text)
+	{
+		HTKConfig config;
+		istringstream in(text);
+		config.parse(in);
+		return config;
+	}
+
+	/// <summary>	Whether hcopy_settings rejects the configuration. </summary>
+	bool rejected(const string& text)
+	{
+		try {
+			parse("SOURCERATE = 625\n" + text).hcopy_settings();
+		}
+		catch (const runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>	Whether parsing the lines throws. </summary>
+	bool invalid(const string& text)
+	{
+		try {
+			parse(text);
+		}
+		catch (const runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	void check_parser()
+	{
+		const HTKConfig config = parse(
+			"# comment\n"
+			"  SOURCERATE = 625   # 16 kHz\n"
+			"HPARM: targetkind = MFCC_E\n"
+			"\n"
+			"name = \"quoted value\"\n"
+			"Flag = t\n"
+			"NUMCHANS = 20\n"
+			"NUMCHANS = 24\n");
+		CHECK(config.has("sourcerate"));
+		CHECK(!config.has("TARGETRATE"));
+		CHECK(config.get("TARGETKIND") == "MFCC_E");
+		CHECK(config.get("NAME") == "quoted value");
+		CHECK(config.get("missing", "fallback") == "fallback");
+		CHECK(config.get_number("SOURCERATE", 0) == 625);
+		CHECK(config.get_number("NUMCHANS", 0) == 24);
+		CHECK(config.get_number("TARGETRATE", 100000) == 100000);
+		CHECK(config.get_bool("FLAG", false));
+		CHECK(!config.get_bool("OTHER", false));
+
+		bool thrown = false;
+		try {
+			config.get_number("NAME", 0);
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		thrown = false;
+		try {
+			config.get_bool("NUMCHANS", false);
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		CHECK(invalid("SOURCERATE 625\n"));
+		CHECK(invalid(" = 625\n"));
+	}
+
+	void check_hcopy_settings()
+	{
+		// the configuration of the sample
+		const HCopySettings s = parse(
+			"SOURCEKIND = WAVEFORM\n"
+			"SOURCEFORMAT = NOHEAD\n"
+			"SOURCERATE = 625\n"
+			"TARGETRATE = 100000\n"
+			"WINDOWSIZE = 250000\n"
+			"NUMCHANS = 26\n"
+			"LOFREQ = 80\n"
+			"HIFREQ = 7500\n"
+			"NUMCEPS = 12\n"
+			"CEPLIFTER = 22\n"
+			"ENORMALISE = FALSE\n"
+			"TARGETKIND = MFCC_D_A_0\n"
+			"SAVEWITHCRC = FALSE\n").hcopy_settings();
+		CHECK(s.mfcc.samp_freq == 16000);
+		CHECK(s.mfcc.win_len == 400);
+		CHECK(s.mfcc.win_shift == 160);
+		CHECK(s.mfcc.filter_num == 26);
+		CHECK(s.mfcc.lo_freq == 80 && s.mfcc.hi_freq == 7500);
+		CHECK(s.mfcc.mfcc_num == 12 && s.mfcc.lifter_num == 22);
+		CHECK(s.mfcc.feat_mfcc && !s.mfcc.feat_melspec);
+		CHECK(s.mfcc.feat_energy && s.mfcc.ceps_energy && !s.mfcc.cmn);
+		CHECK(s.delta_order == 2 && s.deltawin == 2);
+		CHECK(s.basic_kind == "MFCC");
+		CHECK(s.qualifiers == set<string>({ "0", "D", "A" }));
+		CHECK(s.target_rate == 100000);
+		CHECK(s.order == HTKByteOrder::big_endian);
+
+		const HCopySettings f = parse(
+			"SOURCERATE = 625\n"
+			"TARGETKIND = FBANK_E_D\n"
+			"SAVECOMPRESSED = T\n"
+			"NATURALWRITEORDER = T\n").hcopy_settings();
+		CHECK(f.mfcc.feat_melspec && !f.mfcc.feat_mfcc);
+		CHECK(f.mfcc.feat_energy && !f.mfcc.ceps_energy && f.mfcc.enormalise);
+		CHECK(f.delta_order == 1);
+		CHECK(f.qualifiers == set<string>({ "E", "D", "C", "K" }));
+		CHECK(f.order == HTKByteOrder::natural);
+
+		CHECK(rejected("TARGETKIND = PLP\n"));
+		CHECK(rejected("TARGETKIND = MFCC_E_0\n"));
+		CHECK(rejected("TARGETKIND = MFCC_A\n"));
+		CHECK(rejected("TARGETKIND = MFCC_V\n"));
+		CHECK(rejected("TARGETKIND = FBANK_Z\n"));
+		CHECK(rejected("USEPOWER = T\n"));
+		CHECK(rejected("DELTAWINDOW = 2\nACCWINDOW = 3\n"));
+		CHECK(!rejected("TARGETKIND = MFCC_E_D_A_Z\n"));
+
+		bool thrown = false;
+		try {
+			parse("TARGETKIND = MFCC\n").hcopy_settings();
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks the parser of HTK configuration files and the translation of the HCopy parameters to
+///	MFCC_HTK, including the settings that must be rejected.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	check_parser();
+	check_hcopy_settings();
+	return check_result();
+}
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <armadillo>
+#include "check.h"
+#include "htk_file.h"
+
+using namespace std;
+
+namespace {
+
+	const char* const filename = "test_htk_file.htk";
+
+	/// <summary>	Saves data and loads it back, in the given layout. </summary>
+	template<typename eT>
+	HTKFile_T<eT> round_trip(const arma::Mat<eT>& data, const string& basic_kind, const set<string>& qualifiers,
+		FeatureLayout layout = FeatureLayout::frame_major)
+	{
+		HTKFile_T<eT> out(layout);
+		out.set_data(data, 100000, basic_kind, qualifiers);
+		CHECK(out.save(filename));
+
+		HTKFile_T<eT> in(layout);
+		CHECK(in.load(filename, true));
+		CHECK(in.samp_period() == 100000);
+		CHECK(in.basic_kind() == basic_kind);
+		CHECK(in.qualifiers() == qualifiers);
+		CHECK(in.data().n_rows == data.n_rows && in.data().n_cols == data.n_cols);
+		return in;
+	}
+
+	template<typename eT>
+	void check_round_trip()
+	{
+		typedef arma::Mat<eT> mat_type;
+		// values a float holds exactly
+		const mat_type data = arma::conv_to<mat_type>::from(arma::fmat(arma::randn<arma::fmat>(39, 257) * 10));
+
+		// floats are stored as they are
+		for (FeatureLayout layout : { FeatureLayout::frame_major, FeatureLayout::feature_major }) {
+			const mat_type x = layout == FeatureLayout::frame_major ? data : mat_type(data.t());
+			CHECK(arma::approx_equal(round_trip(x, "MFCC", { "E", "D", "A" }, layout).data(), x, "absdiff", 0));
+			CHECK(arma::approx_equal(round_trip(x, "MFCC", { "E", "D", "A", "K" }, layout).data(), x, "absdiff", 0));
+		}
+
+		// compression keeps every feature within half a step of its 16-bit scale
+		const HTKFile_T<eT> c = round_trip(data, "MFCC", { "E", "C" });
+		for (arma::uword v = 0; v < data.n_rows; ++v) {
+			const double step = (data.row(v).max() - data.row(v).min()) / (2 * 32767.0);
+			const double err = arma::abs(arma::conv_to<arma::rowvec>::from(c.data().row(v) - data.row(v))).max();
+			CHECK(err <= 0.51 * step + 1e-6);
+		}
+		round_trip(data, "MFCC", { "E", "C", "K" });
+
+		// waveforms are stored as 16-bit integers and divided by 32767 on load
+		arma::Mat<eT> wave(1, 65535);
+		for (int c = -32767; c <= 32767; ++c) {
+			wave(0, c + 32767) = static_cast<eT>(c / 32767.0);
+		}
+		CHECK(arma::approx_equal(round_trip(wave, "WAVEFORM", {}).data(), wave, "absdiff", 0));
+	}
+
+	/// <summary>	A damaged payload must fail the CRC check. </summary>
+	void check_crc_mismatch()
+	{
+		HTKFile out;
+		out.set_data(arma::randn(13, 50), 100000, "MFCC", { "K" });
+		CHECK(out.save(filename));
+		{
+			fstream f(filename, ios::in | ios::out | ios::binary);
+			f.seekp(100);
+			f.put('\x5a');
+		}
+
+		HTKFile in;
+		CHECK(in.load(filename));
+		bool thrown = false;
+		try {
+			in.load(filename, true);
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that HTKFile loads what it saved: plain floats exactly, compressed files (_C) within
+///	the quantization step, files with a CRC (_K) with the CRC verified, and WAVEFORM samples.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	check_round_trip<double>();
+	check_round_trip<float>();
+	check_crc_mismatch();
+	remove(filename);
+	return check_result();
+}
@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "check.h"
+#include "htk_file.h"
+#include "htk_probe.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+	const string dir = "test_htk_probe.dir";
+
+	void make_dir(const string& path)
+	{
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+
+	void remove_dir(const string& path)
+	{
+#ifdef _WIN32
+		_rmdir(path.c_str());
+#else
+		rmdir(path.c_str());
+#endif
+	}
+
+	/// <summary>	Saves an HTK file with the given shape. </summary>
+	void save(const string& path, arma::uword features, arma::uword samples, const string& kind,
+		const set<string>& qualifiers, HTKByteOrder order = HTKByteOrder::big_endian)
+	{
+		HTKFile out(FeatureLayout::frame_major, order);
+		out.set_data(arma::randn(features, samples), 100000, kind, qualifiers);
+		CHECK(out.save(path));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that probe_htk and scan_htk read the headers of valid files and reject truncated and
+///	missing ones, that list_htk_dir finds files recursively without following a symlinked
+///	directory, and that read_htk_script takes the last path of every line.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	make_dir(dir);
+	make_dir(dir + "/sub");
+	const string a = dir + "/a.htk", b = dir + "/sub/b.htk", natural = dir + "/sub/n.htk";
+	const string truncated = dir + "/t.htk", text = dir + "/c.txt";
+	save(a, 39, 312, "MFCC", { "0", "D", "A" });
+	save(b, 26, 7, "FBANK", { "E", "C" });
+	save(natural, 13, 5, "MFCC", {}, HTKByteOrder::natural);
+	{
+		// the first 11 bytes of a header
+		ifstream in(a, ios::binary);
+		char header[11];
+		in.read(header, sizeof(header));
+		ofstream(truncated, ios::binary).write(header, sizeof(header));
+		ofstream(text) << "not an HTK file\n";
+	}
+
+	HTKHeader header;
+	CHECK(probe_htk(a, header));
+	CHECK(header.samples == 312 && header.samp_period == 100000 && header.features() == 39);
+	CHECK(header.basic_kind() == htk_kind::MFCC && header.has(htk_kind::D | htk_kind::A | htk_kind::Zero));
+	CHECK(header.kind_name() == "MFCC_D_A_0");
+	CHECK(probe_htk(b, header));
+	CHECK(header.samples == 7 && header.features() == 26 && header.has(htk_kind::C));
+	CHECK(probe_htk(natural, header, HTKByteOrder::natural));
+	CHECK(header.samples == 5 && header.features() == 13);
+	CHECK(!probe_htk(truncated, header));
+	CHECK(!probe_htk(dir + "/missing.htk", header));
+
+	// a link to the directory itself must not make the listing recurse forever
+#ifndef _WIN32
+	remove((dir + "/sub/loop").c_str());
+	CHECK(symlink(".", (dir + "/sub/loop").c_str()) == 0);
+#endif
+	const vector<string> paths = list_htk_dir(dir);
+	CHECK(paths == vector<string>({ a, b, natural, truncated }));
+	CHECK(list_htk_dir(dir, "").size() == 5);
+
+	// HCopy scripts list the source and the target, the target is read
+	{
+		ofstream script(dir + "/list.scp");
+		script << "in/a.wav " << a << "\n\n  " << b << "  \n" << "x y\t" << truncated << "\n";
+	}
+	const vector<string> script = read_htk_script(dir + "/list.scp");
+	CHECK(script == vector<string>({ a, b, truncated }));
+
+	const vector<HTKManifestEntry> entries = scan_htk(script, 2);
+	CHECK(entries.size() == 3);
+	CHECK(entries[0].ok && entries[0].path == a && entries[0].header.samples == 312);
+	CHECK(entries[1].ok && entries[1].path == b && entries[1].header.features() == 26);
+	CHECK(!entries[2].ok && entries[2].path == truncated);
+
+	ostringstream manifest;
+	CHECK(write_htk_manifest(manifest, entries) == 2);
+	CHECK(manifest.str() == a + "\t312\t39\t100000\tMFCC_D_A_0\n" + b + "\t7\t26\t100000\tFBANK_E_C\n");
+
+#ifndef _WIN32
+	remove((dir + "/sub/loop").c_str());
+#endif
+	for (const string& path : { a, b, natural, truncated, text, dir + "/list.scp" }) {
+		remove(path.c_str());
+	}
+	remove_dir(dir + "/sub");
+	remove_dir(dir);
+	return check_result();
+}
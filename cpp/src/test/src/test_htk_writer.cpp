@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <armadillo>
+#include "check.h"
+#include "htk_file.h"
+#include "htk_writer.h"
+
+using namespace std;
+
+namespace {
+
+	const char* const filename = "test_htk_writer.htk";
+	const char* const saved = "test_htk_writer.saved.htk";
+
+	/// <summary>	Whether fn throws std::runtime_error. </summary>
+	template<typename F>
+	bool throws(F fn)
+	{
+		try {
+			fn();
+		}
+		catch (const runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	string read_file(const char* name)
+	{
+		ifstream in(name, ios::binary);
+		return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that HTKWriter writes samples given in chunks of every kind, over several blocks and
+///	then appended to the file, into the file HTKFile::save writes, with a valid CRC, and that it
+///	rejects compression.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	const arma::fmat samples = arma::randn<arma::fmat>(13, 30000);
+	const arma::mat data = arma::conv_to<arma::mat>::from(samples);
+	const set<string> qualifiers = { "E", "K" };
+
+	{
+		HTKWriter writer(filename, 13, 100000, "MFCC", qualifiers);
+		writer.write(data.colptr(0));
+		writer.write(data.cols(1, 999));
+		writer.write(samples.cols(1000, 9999));
+		writer.write(arma::mat(data.cols(10000, 19999).t()), FeatureLayout::feature_major);
+		CHECK(writer.samples() == 20000);
+		writer.close();
+	}
+	{
+		HTKWriter writer(filename, 13, 100000, "MFCC", qualifiers, true);
+		CHECK(writer.samples() == 20000);
+		writer.write(samples.cols(20000, 29999));
+		writer.close();
+		CHECK(writer.samples() == 30000);
+	}
+
+	HTKFile in;
+	CHECK(in.load(filename, true));
+	CHECK(in.samples() == 30000 && in.basic_kind() == "MFCC" && in.qualifiers() == qualifiers);
+	CHECK(arma::approx_equal(in.data(), data, "absdiff", 0));
+
+	HTKFile out;
+	out.set_data(data, 100000, "MFCC", qualifiers);
+	CHECK(out.save(saved));
+	CHECK(read_file(filename) == read_file(saved));
+
+	// the ranges of a compressed file are not known until the end, a different kind cannot be appended
+	CHECK(throws([] { HTKWriter(filename, 13, 100000, "MFCC", { "E", "C" }); }));
+	CHECK(throws([] { HTKWriter(filename, 13, 100000, "MFCC", { "E" }, true); }));
+	CHECK(throws([] { HTKWriter(filename, 13, 50000, "MFCC", { "E", "K" }, true); }));
+	CHECK(in.load(filename, true) && in.samples() == 30000);
+
+	remove(filename);
+	remove(saved);
+	return check_result();
+}
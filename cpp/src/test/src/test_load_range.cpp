@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <armadillo>
+#include "check.h"
+#include "htk_file.h"
+
+using namespace std;
+
+namespace {
+
+	const char* const filename = "test_load_range.htk";
+	const char* const truncated = "test_load_range.truncated.htk";
+
+	/// <summary>	Whether fn throws std::runtime_error. </summary>
+	template<typename F>
+	bool throws(F fn)
+	{
+		try {
+			fn();
+		}
+		catch (const runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>	Writes the first size bytes of src to dst. </summary>
+	void truncate_copy(const char* src, const char* dst, size_t size)
+	{
+		ifstream in(src, ios::binary);
+		vector<char> bytes(size);
+		in.read(bytes.data(), bytes.size());
+		ofstream(dst, ios::binary).write(bytes.data(), in.gcount());
+	}
+
+	/// <summary>	Compares load_range with the same samples of a full load. </summary>
+	void check_ranges(const set<string>& qualifiers, FeatureLayout layout)
+	{
+		HTKFile out(layout);
+		const arma::mat data = arma::conv_to<arma::mat>::from(arma::fmat(arma::randn<arma::fmat>(13, 3000)));
+		out.set_data(layout == FeatureLayout::frame_major ? data : arma::mat(data.t()), 100000, "MFCC", qualifiers);
+		CHECK(out.save(filename));
+
+		HTKFile full(layout);
+		CHECK(full.load(filename));
+		for (int32_t first : { 0, 1, 1023, 2999 }) {
+			for (int32_t last : { first, first + 1, 1500, 2047, 3000 }) {
+				if (last < first || last > 3000) {
+					continue;
+				}
+				HTKFile part(layout);
+				CHECK(part.load_range(filename, first, last));
+				CHECK(part.samples() == last - first);
+				if (last == first) {
+					continue;
+				}
+				const arma::mat ref = layout == FeatureLayout::frame_major ?
+					arma::mat(full.data().cols(first, last - 1)) : arma::mat(full.data().rows(first, last - 1));
+				CHECK(arma::approx_equal(part.data(), ref, "absdiff", 0));
+			}
+		}
+
+		// a range outside the file throws and leaves the object as it was
+		HTKFile part(layout);
+		CHECK(part.load_range(filename, 10, 20));
+		const arma::mat before = part.data();
+		for (int32_t bad : { -1, 3001 }) {
+			CHECK(throws([&] { part.load_range(filename, 0, bad); }));
+			CHECK(part.samples() == 10 && part.basic_kind() == "MFCC");
+			CHECK(arma::approx_equal(part.data(), before, "absdiff", 0));
+		}
+
+		// so does a file shorter than its header says, or than a header
+		for (size_t size : { size_t(5), size_t(12 + 100) }) {
+			truncate_copy(filename, truncated, size);
+			CHECK(throws([&] { part.load_range(truncated, 0, 3000); }));
+			CHECK(part.samples() == 10);
+			CHECK(arma::approx_equal(part.data(), before, "absdiff", 0));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that HTKFile::load_range returns the samples of a full load, for plain, compressed
+///	and CRC files in both layouts, and rejects ranges outside the file and truncated files
+///	without changing the object.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	for (FeatureLayout layout : { FeatureLayout::frame_major, FeatureLayout::feature_major }) {
+		check_ranges({ "E" }, layout);
+		check_ranges({ "E", "C" }, layout);
+		check_ranges({ "E", "K" }, layout);
+	}
+
+	HTKFile missing;
+	CHECK(!missing.load_range("test_load_range.missing", 0, 1));
+	remove(filename);
+	remove(truncated);
+	return check_result();
+}
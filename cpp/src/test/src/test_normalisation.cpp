@@ -0,0 +1,74 @@
+#include <cmath>
+#include <armadillo>
+#include "check.h"
+#include "mfcc_htk.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	Compares CMN and ENORMALISE with the same normalisation applied to the plain features. </summary>
+	void check_rows(MFCC_HTK_Config config, arma::uword cmn_rows)
+	{
+		config.cmn = false;
+		config.enormalise = false;
+		MFCC_HTK plain(config);
+		const arma::vec signal = plain.load_raw_signal(ARMA_HTK_EXAMPLE_RAW);
+		const arma::mat raw = plain.get_feats(signal);
+
+		// CMN subtracts the utterance mean of the first cmn_rows static features
+		config.cmn = true;
+		arma::mat ref = raw;
+		ref.rows(0, cmn_rows - 1).each_col() -= arma::mean(raw.rows(0, cmn_rows - 1), 1);
+		CHECK(arma::approx_equal(MFCC_HTK(config).get_feats(signal), ref, "absdiff", 1e-9));
+
+		// ENORMALISE only scales a log energy, the last static feature
+		config.cmn = false;
+		config.enormalise = true;
+		ref = raw;
+		if (config.feat_energy && !config.ceps_energy) {
+			const arma::uword e = raw.n_rows - 1;
+			const double max = raw.row(e).max();
+			const double min = max - (config.sil_floor * ::log(10.0)) / 10.0;
+			ref.row(e) = 1.0 - (max - arma::clamp(raw.row(e), min, max)) * config.escale;
+		}
+		const arma::mat feats = MFCC_HTK(config).get_feats(signal);
+		CHECK(arma::approx_equal(feats, ref, "absdiff", 1e-9));
+		CHECK(feats.row(feats.n_rows - 1).max() == 1 || !config.feat_energy || config.ceps_energy);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks which rows CMN and ENORMALISE change: CMN covers every static feature but a log
+///	energy, ENORMALISE only the log energy, which is the last row whatever else is computed.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	MFCC_HTK_Config config;
+	config.filter_compatibility = true;
+	config.lo_freq = 80;
+	config.hi_freq = 7500;
+	config.ceps_energy = false;
+
+	// FBANK_E
+	config.feat_melspec = true;
+	config.feat_mfcc = false;
+	check_rows(config, config.filter_num);
+
+	// melspec, MFCC and log energy
+	config.feat_mfcc = true;
+	check_rows(config, config.filter_num + config.mfcc_num);
+
+	// melspec, MFCC and C0, which CMN covers
+	config.ceps_energy = true;
+	check_rows(config, config.filter_num + config.mfcc_num + 1);
+
+	// MFCC_E as in HTK
+	config.feat_melspec = false;
+	config.ceps_energy = false;
+	check_rows(config, config.mfcc_num);
+	return check_result();
+}
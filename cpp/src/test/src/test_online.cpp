@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <random>
+#include <armadillo>
+#include "check.h"
+#include "online_mfcc_htk.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	Pushes the sample audio in random chunks and compares with the batch features. </summary>
+	template<typename eT>
+	void check_online(const MFCC_HTK_Config& config, int deltawin, int order, unsigned seed)
+	{
+		// the online extractor computes frame by frame whatever block_frames is
+		MFCC_HTK_Config batch = config;
+		batch.block_frames = 1;
+		MFCC_HTK_T<eT> mfcc(batch);
+		const auto signal = mfcc.load_raw_signal(ARMA_HTK_EXAMPLE_RAW);
+		const arma::Mat<eT> ref = mfcc.append_deltas(mfcc.get_feats(signal), deltawin, order);
+
+		OnlineMFCC_HTK_T<eT> online(config, deltawin, order);
+		CHECK(online.feat_num() == static_cast<int>(ref.n_rows));
+
+		// twice, the second utterance after flush must be the same
+		mt19937 rng(seed);
+		for (int utterance = 0; utterance < 2; ++utterance) {
+			arma::Mat<eT> feats(online.feat_num(), 0);
+			for (arma::uword pos = 0; pos < signal.n_elem;) {
+				const arma::uword n = min<arma::uword>(rng() % 900, signal.n_elem - pos);
+				feats = arma::join_rows(feats, online.push(signal.memptr() + pos, n));
+				pos += n;
+			}
+			feats = arma::join_rows(feats, online.flush());
+
+			CHECK(feats.n_rows == ref.n_rows && feats.n_cols == ref.n_cols);
+			if (feats.n_rows == ref.n_rows && feats.n_cols == ref.n_cols) {
+				CHECK(arma::approx_equal(feats, ref, "absdiff", 0));
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that OnlineMFCC_HTK returns exactly the features and differences of get_feats and
+///	append_deltas on the whole signal with block_frames = 1, whatever block_frames the online
+///	config has, and that every push returns the frames it completed.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	MFCC_HTK_Config config;
+	config.filter_compatibility = true;
+	config.lo_freq = 80;
+	config.hi_freq = 7500;
+	for (int order = 0; order <= 3; ++order) {
+		for (int block_frames : { 1, 32 }) {
+			config.block_frames = block_frames;
+			for (int deltawin : { 1, 2, 3 }) {
+				const unsigned seed = static_cast<unsigned>(order * 10 + deltawin);
+				check_online<double>(config, deltawin, order, seed);
+				check_online<float>(config, deltawin, order, seed);
+			}
+		}
+	}
+
+	// without deltas a frame is returned as soon as its window is complete
+	OnlineMFCC_HTK online(config, 2, 0);
+	const arma::vec window = arma::randn(config.win_len);
+	const arma::vec shift = arma::randn(config.win_shift);
+	CHECK(online.push(window).n_cols == 1);
+	CHECK(online.push(shift).n_cols == 1);
+	CHECK(online.push(shift.head(config.win_shift - 1)).n_cols == 0);
+	CHECK(online.push(shift.tail(1)).n_cols == 1);
+	return check_result();
+}
@@ -0,0 +1,55 @@
+#include <armadillo>
+#include "check.h"
+#include "real_fft.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	Compares RealFFT with arma::fft on random input of len samples. </summary>
+	template<typename eT>
+	void check_fft(int n, int len, double tolerance)
+	{
+		typedef typename RealFFT<eT>::cx_type cx_type;
+		const RealFFT<eT> fft(n);
+		CHECK(fft.size() == n);
+
+		const arma::Col<eT> in = arma::randn<arma::Col<eT>>(len);
+		arma::vec padded = arma::zeros<arma::vec>(n);
+		padded.head(min(len, n)) = arma::conv_to<arma::vec>::from(in.head(min(len, n)));
+		const arma::cx_vec ref = arma::fft(padded);
+
+		vector<cx_type> out(n / 2 + 1);
+		fft.forward(in.memptr(), len, out.data());
+		double err = 0;
+		for (int k = 0; k <= n / 2; ++k) {
+			err = max(err, abs(complex<double>(out[k]) - ref(k)));
+		}
+		CHECK(err <= tolerance * n);
+
+		vector<cx_type> work(fft.work_size());
+		arma::Col<eT> mag(n / 2);
+		fft.magnitude(in.memptr(), len, mag.memptr(), work.data());
+		err = 0;
+		for (int k = 0; k < n / 2; ++k) {
+			err = max(err, abs(mag(k) - abs(ref(k))));
+		}
+		CHECK(err <= tolerance * n);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>	Checks RealFFT against arma::fft for all lengths up to 4096, with zero padding. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	arma::arma_rng::set_seed(1);
+	for (int n = 2; n <= 4096; n *= 2) {
+		for (int len : { n, n / 2 + 1, n + 3 }) {
+			check_fft<double>(n, len, 1e-12);
+			check_fft<float>(n, len, 1e-5);
+		}
+	}
+	return check_result();
+}
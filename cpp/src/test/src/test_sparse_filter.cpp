@@ -0,0 +1,58 @@
+#include <armadillo>
+#include "check.h"
+#include "mfcc_htk.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	The largest difference relative to the largest magnitude of ref. </summary>
+	template<typename eT>
+	double relative_error(const arma::Mat<eT>& x, const arma::Mat<eT>& ref)
+	{
+		return arma::abs(arma::conv_to<arma::mat>::from(x - ref)).max() / arma::abs(ref).max();
+	}
+
+	/// <summary>	Compares the sparse filterbank with the dense product for one configuration. </summary>
+	template<typename eT>
+	void check_sparse(MFCC_HTK_Config config, double tolerance)
+	{
+		config.sparse_filter = false;
+		MFCC_HTK_T<eT> dense(config);
+		config.sparse_filter = true;
+		MFCC_HTK_T<eT> sparse(config);
+
+		const auto signal = dense.load_raw_signal(ARMA_HTK_EXAMPLE_RAW);
+		const arma::Mat<eT> ref = dense.get_feats(signal);
+		const arma::Mat<eT> feats = sparse.get_feats(signal);
+		CHECK(ref.n_cols > 0);
+		CHECK(feats.n_rows == ref.n_rows && feats.n_cols == ref.n_cols);
+		if (feats.n_rows == ref.n_rows && feats.n_cols == ref.n_cols) {
+			CHECK(relative_error(feats, ref) <= tolerance);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that the sparse filterbank (sparse_filter) gives the features of the dense matrix
+///	product, for the mel spectrum and the MFCCs, both filter layouts and both precisions.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	for (bool compatibility : { false, true }) {
+		for (bool melspec : { false, true }) {
+			MFCC_HTK_Config config;
+			config.filter_compatibility = compatibility;
+			config.lo_freq = 80;
+			config.hi_freq = 7500;
+			config.feat_melspec = melspec;
+			config.feat_mfcc = !melspec;
+			check_sparse<double>(config, 1e-12);
+			check_sparse<float>(config, 1e-5);
+		}
+	}
+	return check_result();
+}
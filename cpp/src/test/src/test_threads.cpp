@@ -0,0 +1,62 @@
+#include <armadillo>
+#include "check.h"
+#include "mfcc_htk.h"
+
+using namespace std;
+
+namespace {
+
+	/// <summary>	Compares get_feats on several threads with one thread, they must be identical. </summary>
+	template<typename eT>
+	void check_threads(MFCC_HTK_Config config)
+	{
+		config.num_threads = 1;
+		MFCC_HTK_T<eT> single(config);
+		const auto signal = single.load_raw_signal(ARMA_HTK_EXAMPLE_RAW);
+		const arma::Mat<eT> ref = single.get_feats(signal);
+
+		for (int threads : { 2, 3, 8 }) {
+			config.num_threads = threads;
+			MFCC_HTK_T<eT> mfcc(config);
+			const arma::Mat<eT> feats = mfcc.get_feats(signal);
+			CHECK(feats.n_rows == ref.n_rows && feats.n_cols == ref.n_cols);
+			if (feats.n_rows == ref.n_rows && feats.n_cols == ref.n_cols) {
+				CHECK(arma::all(arma::vectorise(feats == ref)));
+			}
+
+			// the batch API computes every signal on one thread
+			const vector<arma::Mat<eT>> batch = mfcc.get_feats_batch({ signal, signal.head(5000), signal });
+			CHECK(batch.size() == 3);
+			CHECK(arma::approx_equal(batch[0], ref, "absdiff", 0));
+			CHECK(arma::approx_equal(batch[2], ref, "absdiff", 0));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+///	Checks that the features do not depend on num_threads, including the per-utterance CMN and
+///	energy normalisation that are combined over the blocks of all threads.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+	MFCC_HTK_Config config;
+	config.filter_compatibility = true;
+	config.lo_freq = 80;
+	config.hi_freq = 7500;
+	check_threads<double>(config);
+	check_threads<float>(config);
+
+	config.ceps_energy = false;
+	config.raw_energy = true;
+	config.enormalise = true;
+	config.cmn = true;
+	check_threads<double>(config);
+	check_threads<float>(config);
+
+	config.layout = FeatureLayout::feature_major;
+	check_threads<double>(config);
+	return check_result();
+}